@@ -30,11 +30,24 @@
  */
 
 #include "Adafruit_Thermal.h"
+#include "Adafruit_ThermalRing.h"
+#include "Adafruit_ThermalTrace.h"
+
+#if !defined(ARDUINO) && defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 // Though most of these printers are factory configured for 19200 baud
-// operation, a few rare specimens instead work at 9600.  If so, change
-// this constant.  This will NOT make printing slower!  The physical
-// print and feed mechanisms are the bottleneck, not the port speed.
+// operation, a few rare specimens instead work at 9600, and many can be
+// reconfigured for faster rates (up to 115200).  This constant is only
+// the default assumed by the output throttling; if your serial port runs
+// at a different speed, call setBaudRate() (or autoBaud() before begin())
+// so each byte is timed correctly.  At 19200 baud the physical print
+// mechanism is usually the bottleneck, but bitmap-heavy jobs can be
+// limited by the serial link.
 #define BAUDRATE                                                               \
   19200 //!< How many bits per second the serial port should transfer
 
@@ -60,35 +73,387 @@
 // while the printer physically completes the task.
 
 /*!
- * Number of microseconds to issue one byte to the printer.  11 bits
- * (not 8) to accommodate idle, start and stop bits.  Idle time might
- * be unnecessary, but erring on side of caution here.
+ * Number of microseconds to issue one byte to the printer at a given baud
+ * rate.  11 bits (not 8) to accommodate idle, start and stop bits.  Idle
+ * time might be unnecessary, but erring on side of caution here.
  */
-#define BYTE_TIME (((11L * 1000000L) + (BAUDRATE / 2)) / BAUDRATE)
+#define BYTE_TIME(baud) (((11L * 1000000L) + ((baud) / 2)) / (baud))
+
+#define DEFAULT_BUFFER_SIZE 256 //!< Printer input buffer size, in bytes
+#define STATUS_TIMEOUT 1000 //!< Max wait for a status reply, in milliseconds
+#define STATUS_RESERVED 0x90 //!< Status reply bits fixed at 0 (bits 4 and 7)
+#define PROBE_REPLIES 3 //!< Matching replies needed to accept a baud rate
+#define DTR_TIMEOUT 5000 //!< Default max wait for DTR ready, in milliseconds
+#define SLEEP_MARGIN 250 //!< Wake this long before sleep is due, milliseconds
+#define PAPER_CHECK_INTERVAL 500 //!< Time between printJob() paper checks, ms
+#define FEED_HOLD_MAX 65535UL //!< Most feed pendingFeed can hold, in dots
+
+// Automatic timing adjustment (see setAutoTune()):
+#define TUNE_PRINT 1         //!< Tuning sample is for dotPrintTime
+#define TUNE_FEED 2          //!< Tuning sample is for dotFeedTime
+#define TUNE_MIN_ROWS 24     //!< Fewer rows than this are too short to time
+#define TUNE_MIN_TIME 500    //!< Lower bound for tuned times, microseconds
+#define TUNE_MAX_LATENCY 2000 //!< Max gap between reply polls, microseconds
+
+// Automatic heat profiles (see setAutoHeat()):
+#define HEAT_LIGHT 0       //!< Sparse content: text, light bitmap rows
+#define HEAT_DENSE 1       //!< Anything darker (begin()'s settings)
+#define HEAT_NONE 255      //!< Printer on other settings (setHeatConfig())
+#define HEAT_LIGHT_DOTS 48 //!< Most dots in a light row, 1/8 of the width
+#define HEAT_CHUNK_ROWS 8  //!< Bitmap rows per chunk, for switching
+#define HEAT_RESERVE 5     //!< ESC 7 bytes sent between chunks
+
+// printJob() progress:
+#define JOB_NONE 0   //!< Not in printJob()
+#define JOB_RUN 1    //!< Printing, checking for paper
+#define JOB_REPLAY 2 //!< Resuming: skipping what printed before paper out
+#define JOB_PAUSED 3 //!< Paper out: dropping the rest of the job
+
+// Heating dots, heat time, heat interval (as for setHeatConfig()) and
+// print time relative to begin()'s settings, in 128ths, for each class.
+// Light rows heat in one pass however many dots are allowed at once, so
+// the shorter heat time and interval are all gain; on dense rows they'd
+// fade, and heating more dots at once draws more than a 2A supply can
+// give, so those keep begin()'s throttled-back settings.
+static const uint8_t heatProfiles[][4] PROGMEM = {{15, 100, 20, 96},
+                                                  {11, 120, 40, 128}};
+
+// Print time for a heat class, relative to begin()'s settings, in 128ths.
+static uint8_t heatScale(uint8_t c) {
+  return (c == HEAT_NONE) ? 128 : pgm_read_byte(&heatProfiles[c][3]);
+}
+
+// Baud rates tried by the begin() probe (see autoBaud()), fastest first.
+static const unsigned long probeRates[] = {115200, 57600, 38400, 19200, 9600};
 
 // Constructor
 Adafruit_Thermal::Adafruit_Thermal(Stream *s, uint8_t dtr)
     : stream(s), dtrPin(dtr) {
   dtrEnabled = false;
+  statusBoot = false;
+  startupMicros = 0;
+  statusPending = false;
+  lastStatus = 0;
+  paperState = PAPER_UNKNOWN;
+  statusUpdateTime = 0;
+  statusQueryTime = 0;
+  paperCallback = NULL;
+  readyFunc = NULL;
+  idleFunc = NULL;
+  dtrTimeout = DTR_TIMEOUT;
+  errorCode = THERMAL_OK;
+  autoTune = false;
+  ring = NULL;
+  trace = NULL;
+  tuneKind = 0;
+  tuneRows = 0;
+  lastCollect = 0;
+  byteTime = BYTE_TIME(BAUDRATE);
+  bufferSize = DEFAULT_BUFFER_SIZE;
+  barcodeWidth = 3;
+  barcodeSent = 0;
+  bitmapScale = BITMAP_NORMAL;
+  autoHeat = false;
+  heatClass = HEAT_NONE;
+  baudSetter = NULL;
+  lines = 0;
+  resets = 0;
+  feedCoalesce = false;
+  pendingFeed = 0;
+  estimating = false;
+  estimateClock = 0;
+  sleepKnown = false;
+  wakePending = false;
+  settling = false;
+  settleTime = 0;
+  sleepSeconds = 0;
+  lastActivity = 0;
+  align = underline = rasterMode = 0;
+  jobState = JOB_NONE;
+  jobQuery = false;
+  jobHeld = false;
+  lineHeld = false;
+  bandMore = bandCont = false;
+  jobBytes = jobRows = queryBytes = queryRows = 0;
+  resumeBytes = resumeRows = 0;
 }
 
 // This method sets the estimated completion time for a just-issued task.
+// In ring mode the time is queued along with the data, for service().
 void Adafruit_Thermal::timeoutSet(unsigned long x) {
-  if (!dtrEnabled)
-    resumeTime = micros() + x;
+  if (ring)
+    ring->pushDelay(x);
+  else if (!dtrEnabled)
+    resumeTime = now() + x;
+}
+
+// Like timeoutSet(), for a wait the DTR line doesn't cover: just after
+// the wake-up byte the printer reports ready but still misreads commands,
+// so with DTR the time is kept separately and waited out as well.
+void Adafruit_Thermal::settle(unsigned long x) {
+  if (ring) {
+    ring->pushSettle(x);
+  } else if (dtrEnabled) {
+    settleTime = micros() + x;
+    settling = true;
+  } else {
+    timeoutSet(x);
+  }
 }
 
 // This function waits (if necessary) for the prior task to complete.
+// Any outstanding status reply is collected while waiting.  With DTR
+// handshaking, a printer that stays busy longer than the DTR timeout is
+// assumed disconnected: THERMAL_DTR_TIMEOUT is reported via lastError()
+// and further waits are skipped until clearError(), so the sketch can't
+// hang on a missing printer.
 void Adafruit_Thermal::timeoutWait() {
+  if (wakePending)
+    finishWake(); // Printer must be awake before anything else arrives
+  if (pendingFeed)
+    flushFeed(); // Held-back feed goes ahead of whatever's being sent
+  if (!estimating)
+    lastActivity = millis(); // Restarts the printer's sleep timer
+  if (ring)
+    return; // Output is queued; service() does the waiting
+  if (estimating) {
+    if ((long)(resumeTime - estimateClock) > 0L)
+      estimateClock = resumeTime; // Dry run: skip ahead rather than wait
+    return;
+  }
+  unsigned long waitStart = trace ? micros() : 0;
   if (dtrEnabled) {
-    while (digitalRead(dtrPin) == HIGH) {
-      yield();
+    if (errorCode == THERMAL_DTR_TIMEOUT)
+      return;
+    unsigned long startTime = millis();
+    bool busy = trace && !printerReady(); // (only tracked when tracing)
+    if (busy)
+      trace->add(TRACE_DTR, waitStart, 0);
+    while (!printerReady()) {
+      if (dtrTimeout && ((millis() - startTime) >= dtrTimeout)) {
+        errorCode = THERMAL_DTR_TIMEOUT;
+        break;
+      }
+      collectStatus();
+      idle();
     };
+    if (busy && (errorCode != THERMAL_DTR_TIMEOUT))
+      trace->add(TRACE_DTR, micros(), 1);
+    while (settling && ((long)(micros() - settleTime) < 0L)) {
+      collectStatus();
+      idle();
+    }
+    settling = false;
   } else {
     while ((long)(micros() - resumeTime) < 0L) {
-      yield();
+      collectStatus();
+      idle();
     }; // (syntax is rollover-proof)
   }
+  if (trace)
+    trace->add(TRACE_WAIT, waitStart, micros() - waitStart);
+  collectStatus();
+}
+
+// Record output, waits and DTR transitions in the given trace (see
+// Adafruit_ThermalTrace), or stop recording if NULL.  Tracing costs a
+// micros() call or two per byte sent.
+void Adafruit_Thermal::setTrace(Adafruit_ThermalTrace *t) { trace = t; }
+
+// Ring mode splits the work of printing between two threads (or cores,
+// or an interrupt and the main loop).  After setRing(), everything this
+// object outputs -- text, commands, bitmaps -- is queued in the ring along
+// with the timing the printer needs, and returns without waiting.  The
+// consumer calls service() to send the queued data to the serial port
+// the object was constructed with, paced as it would be without the
+// ring.  Status queries (hasPaper() etc.) don't work in ring mode, since
+// the printer's replies aren't routed back through the ring.  Pass NULL
+// to go back to direct output; so does passing a ring whose size was
+// invalid, rather than queueing into a ring that can't hold anything.
+void Adafruit_Thermal::setRing(Adafruit_ThermalRing *r) {
+  if (r && !r->valid())
+    r = NULL;
+  if (ring)
+    stream = port;
+  ring = r;
+  if (ring) {
+    port = stream;
+    stream = ring;
+    rowActive = rowQueued = false;
+  }
+}
+
+// Consumer side of ring mode: send queued data to the printer as far as
+// the timing model (or DTR) allows, without blocking.  Returns true if
+// data remains queued, in which case call again soon.
+bool Adafruit_Thermal::service() {
+  uint8_t buf[RING_MAX_RUN], n;
+
+  if (!ring)
+    return false;
+  for (;;) {
+    switch (ring->peekType()) {
+    case RING_EMPTY:
+      return false;
+    case RING_DELAY:
+      if (dtrEnabled)
+        ring->skip();
+      else
+        resumeTime = micros() + ring->readValue();
+      break;
+    case RING_SETTLE:
+      settleTime = micros() + ring->readValue();
+      if (dtrEnabled)
+        settling = true;
+      else
+        resumeTime = settleTime;
+      break;
+    case RING_ROW:
+      ring->readRow(&ringRows, &ringRowTime);
+      if (!rowActive) { // First row of a bitmap
+        headTime = micros();
+        rowActive = true;
+      }
+      rowWait(ringRows, ringRowTime);
+      rowQueued = true;
+      break;
+    case RING_SYNC:
+      ring->skip();
+      if (rowActive && ((long)(headTime - resumeTime) > 0L))
+        resumeTime = headTime;
+      rowActive = false;
+      break;
+    default: // RING_RUN
+      if (waitTime() > 0L)
+        return true;
+      n = ring->readRun(buf);
+      port->write(buf, n);
+      if (rowQueued) {
+        rowSent(n, ringRowTime);
+        rowQueued = false;
+      }
+    }
+  }
+}
+
+// Microseconds until the printer can accept more data without waiting;
+// zero or negative if it can now.  Lets the sketch (or Adafruit_ThermalPool)
+// get on with other work instead of blocking in timeoutWait().  With DTR
+// handshaking there's no estimate, so a busy printer reports 1 (but the
+// time left to settle after wake-up is known, and reported).
+long Adafruit_Thermal::waitTime() {
+  collectStatus();
+  if (dtrEnabled) {
+    if (errorCode == THERMAL_DTR_TIMEOUT)
+      return 0;
+    if (settling && ((long)(settleTime - micros()) > 0L))
+      return (long)(settleTime - micros());
+    settling = false;
+    return printerReady() ? 0 : 1;
+  }
+  return (long)(resumeTime - now());
+}
+
+// Stands in for the printer during estimate(): counts bytes, discards
+// them, and never answers.
+class estimateStream : public Stream {
+public:
+  unsigned long count;
+  estimateStream() : count(0) {}
+  size_t write(uint8_t /*c*/) {
+    count++;
+    return 1;
+  }
+  size_t write(const uint8_t * /*buffer*/, size_t size) {
+    count += size;
+    return size;
+  }
+  int available() { return 0; }
+  int read() { return -1; }
+  int peek() { return -1; }
+};
+
+// Dry run a job: the job function prints to this object as usual, but
+// output goes to a byte counter and the timing model runs on a virtual
+// clock (see now()) that skips ahead instead of waiting, so nothing is
+// sent and the call returns right away.  The estimate always uses the
+// timing model (as if DTR and the ring weren't in use) and starts from
+// an idle printer in the current font, size and style.  The object's
+// state, copied on entry, is restored afterward.  Objects that remember
+// what the printer holds (Adafruit_ThermalNV, Adafruit_ThermalGlyphs)
+// shouldn't be used by an estimated job, since they'd record output that
+// never happened.  Status queries go unanswered, so the job sees the
+// last known paper state.
+unsigned long Adafruit_Thermal::estimate(thermalJobFunc job, void *ctx,
+                                         unsigned long *bytes) {
+  Adafruit_Thermal saved = *this;
+  estimateStream counter;
+  unsigned long t;
+
+  stream = &counter;
+  ring = NULL;
+  trace = NULL;
+  dtrEnabled = false;
+  autoTune = false;
+  statusPending = false;
+  pendingFeed = 0;
+  estimating = true;
+  estimateClock = resumeTime = headTime = 0;
+
+  job(this, ctx);
+  if (pendingFeed)
+    flushFeed(); // A feed held back at the end still belongs to the job
+  t = ((long)(resumeTime - estimateClock) > 0L) ? resumeTime : estimateClock;
+
+  *this = saved;
+  if (bytes)
+    *bytes = counter.count;
+  return t;
+}
+
+// Time base for the timing model: micros(), or the virtual clock while
+// estimating.
+unsigned long Adafruit_Thermal::now() {
+  return estimating ? estimateClock : micros();
+}
+
+// True if the printer can accept data, per the DTR pin or ready function.
+bool Adafruit_Thermal::printerReady() {
+  return readyFunc ? readyFunc() : (digitalRead(dtrPin) == LOW);
+}
+
+// Called repeatedly while waiting on the printer.
+void Adafruit_Thermal::idle() {
+  if (idleFunc)
+    idleFunc();
+  else
+    yield();
+}
+
+// Replace the DTR pin read with a function returning true when the
+// printer can accept data.  This allows readiness to be tracked from a
+// pin change interrupt (the function just returns a flag the ISR keeps
+// up to date), or emulated when there's no physical pin.  Setting this
+// before begin() enables handshaking even if no DTR pin was passed to the
+// constructor.  Pass NULL to go back to reading the pin.
+void Adafruit_Thermal::setReadyFunc(bool (*ready)(void)) { readyFunc = ready; }
+
+// Set a function to call repeatedly while waiting on the printer, in
+// place of yield().  Combined with a DTR pin change interrupt, this can
+// put the MCU to sleep until the printer is ready.  Pass NULL for yield().
+void Adafruit_Thermal::setIdleFunc(void (*idle)(void)) { idleFunc = idle; }
+
+// Maximum time to wait for DTR before assuming the printer is gone, in
+// milliseconds.  0 waits forever (the old behavior).
+void Adafruit_Thermal::setDtrTimeout(unsigned long ms) { dtrTimeout = ms; }
+
+// Most recent error (THERMAL_OK if none), e.g. THERMAL_DTR_TIMEOUT.
+uint8_t Adafruit_Thermal::lastError() { return errorCode; }
+
+// Clear the error state, re-enabling DTR waits after a timeout.
+void Adafruit_Thermal::clearError() {
+  errorCode = THERMAL_OK;
+  jobHeld = false;
 }
 
 // Printer performance may vary based on the power supply voltage,
@@ -107,37 +472,128 @@ void Adafruit_Thermal::setTimes(unsigned long p, unsigned long f) {
   dotFeedTime = f;
 }
 
+// Set the serial speed used for output throttling.  This does NOT change
+// the speed of the serial port itself (that's up to the sketch, e.g.
+// Serial1.begin(115200)), only the library's estimate of how long each
+// byte takes to transmit.
+void Adafruit_Thermal::setBaudRate(unsigned long baud) {
+  if (baud)
+    byteTime = BYTE_TIME(baud);
+}
+
+// Register a function that reconfigures the host serial port to a given
+// baud rate, e.g.:  void setBaud(unsigned long b) { Serial1.begin(b); }
+// begin() will then probe for the printer's configured speed and leave
+// both the port and the timing model at whatever rate the printer
+// answered.  Pass NULL to disable probing.
+void Adafruit_Thermal::autoBaud(void (*setBaud)(unsigned long)) {
+  baudSetter = setBaud;
+}
+
+// Try each of the candidate baud rates, issuing a paper status query at
+// each and waiting briefly for a reply.  The printer only answers if it
+// understood the query, and a reply read at the wrong speed is garbled,
+// so a rate is accepted only if PROBE_REPLIES replies all match and have
+// the reserved status bits (STATUS_RESERVED) clear, as a real status
+// byte does; line noise rarely manages both.  Returns the detected rate,
+// or 0 if the printer never answered (port and timing are then restored
+// to the BAUDRATE default).  Queries at the wrong speed may be seen by
+// the printer as stray characters; begin() issues a reset afterward,
+// which clears the print buffer.
+unsigned long Adafruit_Thermal::probeBaudRate() {
+  if (!baudSetter)
+    return 0;
+
+  for (uint8_t r = 0; r < sizeof(probeRates) / sizeof(probeRates[0]); r++) {
+    baudSetter(probeRates[r]);
+    setBaudRate(probeRates[r]);
+    int reply[PROBE_REPLIES];
+    uint8_t q;
+    for (q = 0; q < PROBE_REPLIES; q++) {
+      while (stream->available())
+        stream->read(); // Discard anything stale or garbled
+      writeStatusQuery();
+      reply[q] = -1;
+      for (uint8_t i = 0; i < 10 && reply[q] < 0; i++) {
+        delay(5);
+        reply[q] = stream->read();
+      }
+      if ((reply[q] < 0) || (reply[q] & STATUS_RESERVED) ||
+          (q && (reply[q] != reply[0])))
+        break; // Not a status byte, or not the same one
+    }
+    if (q == PROBE_REPLIES)
+      return probeRates[r];
+  }
+
+  baudSetter(BAUDRATE);
+  setBaudRate(BAUDRATE);
+  return 0;
+}
+
 // The next four helper methods are used when issuing configuration
 // commands, printing bitmaps or barcodes, etc.  Not when printing text.
 
 void Adafruit_Thermal::writeBytes(uint8_t a) {
   timeoutWait();
+  if (trace)
+    trace->add(TRACE_COMMAND, micros(), a, 1);
   stream->write(a);
-  timeoutSet(BYTE_TIME);
+  timeoutSet(byteTime);
 }
 
 void Adafruit_Thermal::writeBytes(uint8_t a, uint8_t b) {
   timeoutWait();
+  if (trace)
+    trace->add(TRACE_COMMAND, micros(), a | ((uint16_t)b << 8), 2);
   stream->write(a);
   stream->write(b);
-  timeoutSet(2 * BYTE_TIME);
+  timeoutSet(2 * byteTime);
 }
 
 void Adafruit_Thermal::writeBytes(uint8_t a, uint8_t b, uint8_t c) {
   timeoutWait();
+  if (trace)
+    trace->add(TRACE_COMMAND, micros(),
+               a | ((uint16_t)b << 8) | ((unsigned long)c << 16), 3);
   stream->write(a);
   stream->write(b);
   stream->write(c);
-  timeoutSet(3 * BYTE_TIME);
+  timeoutSet(3 * byteTime);
 }
 
 void Adafruit_Thermal::writeBytes(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
   timeoutWait();
+  if (trace)
+    trace->add(TRACE_COMMAND, micros(),
+               a | ((uint16_t)b << 8) | ((unsigned long)c << 16) |
+                   ((unsigned long)d << 24),
+               4);
   stream->write(a);
   stream->write(b);
   stream->write(c);
   stream->write(d);
-  timeoutSet(4 * BYTE_TIME);
+  timeoutSet(4 * byteTime);
+}
+
+// Commands that print or move paper (feeds, NV images) are sent through
+// here rather than writeBytes(): if the wait turns up a paused job, the
+// command is dropped and false returned.  Settings and downloads still go
+// out whole through writeBytes(), so the printer is never left mid-command.
+bool Adafruit_Thermal::writeOutput(const uint8_t *cmd, uint8_t n) {
+  timeoutWait();
+  if (jobState == JOB_PAUSED)
+    return false; // (Found out while waiting)
+  if (trace) {
+    unsigned long value = 0;
+    for (uint8_t i = 0; i < n; i++)
+      value |= (unsigned long)cmd[i] << (8 * i);
+    trace->add(TRACE_COMMAND, micros(), value, n);
+  }
+  for (uint8_t i = 0; i < n; i++)
+    stream->write(cmd[i]);
+  timeoutSet(n * byteTime);
+  return true;
 }
 
 // The underlying method for all high-level printing (e.g. println()).
@@ -145,43 +601,138 @@ void Adafruit_Thermal::writeBytes(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
 size_t Adafruit_Thermal::write(uint8_t c) {
 
   if (c != 13) { // Strip carriage returns
+    if (jobState == JOB_PAUSED)
+      return 0; // Paper out: the rest of the job is dropped
+    if (jobState)
+      jobBytes++;
+    if (jobState == JOB_REPLAY) {
+      // Printed before the paper ran out; only the column is followed
+      if ((c == '\n') || (column == maxColumn)) {
+        column = 0;
+        c = '\n';
+      } else {
+        column++;
+      }
+      prevByte = c;
+      if ((jobBytes >= resumeBytes) && (jobRows >= resumeRows))
+        resumeJob();
+      return 1;
+    }
+    if (feedCoalesce && (c == '\n') && !column) {
+      // Blank line: feeds the line spacing set by setLineHeight()
+      holdFeed(24 + lineSpacing);
+      prevByte = '\n';
+      lines++;
+      return 1;
+    }
+    // Text is classed at the start of each line, or sooner if a darker
+    // style comes into use partway through.
+    if (autoHeat && (c != '\n') && (!column || (textHeat() == HEAT_DENSE)))
+      setHeatClass(textHeat());
     timeoutWait();
+    if (jobState == JOB_PAUSED)
+      return 0; // (Found out while waiting)
     stream->write(c);
-    unsigned long d = BYTE_TIME;
+    if (trace)
+      trace->add(TRACE_WRITE, micros(), 1);
+    unsigned long d = byteTime;
     if ((c == '\n') || (column == maxColumn)) { // If newline or wrap
       d += (prevByte == '\n') ? ((charHeight + lineSpacing) * dotFeedTime)
                               : // Feed line
                ((charHeight * dotPrintTime) +
                 (lineSpacing * dotFeedTime)); // Text line
       column = 0;
+      lines++;
       c = '\n'; // Treat wrap as newline on next pass
     } else {
       column++;
     }
     timeoutSet(d);
     prevByte = c;
+    if (!column)
+      checkPaper(false); // Between lines
   }
 
   return 1;
 }
 
+// Blocks of text, as from print().  With DTR handshaking, each stretch
+// of a line that can't wrap goes out in one burst while the printer
+// shows ready, rather than with a full wait before every byte; line ends,
+// the start of each line and anything in printJob() go through
+// write(uint8_t) as usual.
+size_t Adafruit_Thermal::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+
+  while ((n < size) && (jobState != JOB_PAUSED)) {
+    uint8_t run = 0;
+    if (dtrEnabled && column && !ring && !estimating && !jobState &&
+        !pendingFeed && !wakePending && !settling &&
+        (errorCode != THERMAL_DTR_TIMEOUT) &&
+        (!autoHeat || (heatClass == HEAT_DENSE) ||
+         (textHeat() == HEAT_LIGHT))) {
+      while ((n + run < size) && (column + run < maxColumn) &&
+             (buffer[n + run] != '\n') && (buffer[n + run] != 13))
+        run++;
+    }
+    if ((run > 1) && printerReady()) {
+      stream->write(buffer + n, run);
+      if (trace)
+        trace->add(TRACE_WRITE, micros(), run);
+      lastActivity = millis();
+      column += run;
+      prevByte = buffer[n + run - 1];
+      n += run;
+    } else if (write(buffer[n])) {
+      n++;
+    } else {
+      break;
+    }
+  }
+
+  return n;
+}
+
 void Adafruit_Thermal::begin(uint16_t version) {
 
+  unsigned long startTime = micros();
+  bool answered = false;
+
   firmware = version;
 
   // The printer can't start receiving data immediately upon power up --
   // it needs a moment to cold boot and initialize.  Allow at least 1/2
-  // sec of uptime before printer can receive data.
-  timeoutSet(500000L);
+  // sec of uptime before printer can receive data, or with fast startup
+  // enabled, only as long as it takes the printer to answer a status
+  // query (still bounded by that same 1/2 sec).
+  if (statusBoot) {
+    answered = waitForPrinter(500000L);
+  } else {
+    timeoutSet(500000L);
+  }
+
+  if (baudSetter && !answered)
+    answered = (probeBaudRate() != 0);
 
-  wake();
+  if (answered) {
+    // A printer that replies to status queries is already awake, so the
+    // wake() delays can be skipped; sleep must still be switched off.
+    if (firmware >= 264) {
+      writeBytes(ASCII_ESC, '8', 0, 0);
+      sleepSeconds = 0;
+      sleepKnown = true;
+    }
+  } else {
+    wake();
+  }
   reset();
 
   setHeatConfig();
 
   // Enable DTR pin if requested
-  if (dtrPin < 255) {
-    pinMode(dtrPin, INPUT_PULLUP);
+  if ((dtrPin < 255) || readyFunc) {
+    if (dtrPin < 255)
+      pinMode(dtrPin, INPUT_PULLUP);
     writeBytes(ASCII_GS, 'a', (1 << 5));
     dtrEnabled = true;
   }
@@ -189,17 +740,76 @@ void Adafruit_Thermal::begin(uint16_t version) {
   dotPrintTime = 30000; // See comments near top of file for
   dotFeedTime = 2100;   // an explanation of these values.
   maxChunkHeight = 255;
+
+  // Time-to-first-dot: when the last setup command will have been
+  // issued, relative to the start of begin().
+  unsigned long now = micros();
+  if (!dtrEnabled && ((long)(resumeTime - now) > 0L))
+    now = resumeTime;
+  startupMicros = now - startTime;
+}
+
+// Enable or disable status-driven startup.  When enabled, begin() polls
+// the printer with paper status queries and proceeds as soon as it
+// answers rather than always waiting out the cold boot time.  Printers
+// that don't support status queries fall back to the full wait.
+void Adafruit_Thermal::fastStartup(bool enable) { statusBoot = enable; }
+
+// Microseconds from the start of begin() until the printer was ready for
+// print data (time-to-first-dot), measured by the most recent begin().
+unsigned long Adafruit_Thermal::startupTime() { return startupMicros; }
+
+// Repeatedly query printer status until it replies or maxWait microseconds
+// elapse.  Returns true if the printer answered.  Queries issued while
+// the printer is still booting are simply ignored by it.
+bool Adafruit_Thermal::waitForPrinter(unsigned long maxWait) {
+  unsigned long startTime = micros();
+  bool answered = false;
+
+  timeoutSet(0);
+  while (stream->available())
+    stream->read(); // Discard any power-up noise
+  do {
+    writeStatusQuery();
+    unsigned long queryTime = micros();
+    while ((micros() - queryTime) < 20000L) { // 20 ms per attempt
+      if (stream->available()) {
+        answered = true;
+        break;
+      }
+      yield();
+    }
+  } while (!answered && ((micros() - startTime) < maxWait));
+
+  delay(2); // Allow the complete reply to arrive, then discard it
+  while (stream->available())
+    stream->read();
+  return answered;
+}
+
+// Issue a paper status query.  The command differs by firmware version.
+void Adafruit_Thermal::writeStatusQuery() {
+  if (firmware >= 264) {
+    writeBytes(ASCII_ESC, 'v', 0);
+  } else {
+    writeBytes(ASCII_GS, 'r', 0);
+  }
 }
 
 // Reset printer to default state.
 void Adafruit_Thermal::reset() {
   writeBytes(ASCII_ESC, '@'); // Init command
+  setHeatClass(HEAT_NONE);
   prevByte = '\n';            // Treat as if prior line is blank
   column = 0;
+  lines++;
+  resets++; // Also clears user-defined characters
   maxColumn = 32;
   charHeight = 24;
   lineSpacing = 6;
   barcodeHeight = 50;
+  barcodeSent = 0; // Barcode label & width back to printer defaults
+  align = underline = rasterMode = 0;
 
   if (firmware >= 264) {
     // Configure tab stops on recent printers
@@ -230,6 +840,8 @@ void Adafruit_Thermal::test() {
 }
 
 void Adafruit_Thermal::testPage() {
+  if (skipOutput())
+    return;
   writeBytes(ASCII_DC2, 'T');
   timeoutSet(dotPrintTime * 24 * 26 + // 26 lines w/text (ea. 24 dots high)
              dotFeedTime *
@@ -243,28 +855,140 @@ void Adafruit_Thermal::setBarcodeHeight(uint8_t val) { // Default is 50
   writeBytes(ASCII_GS, 'h', val);
 }
 
-void Adafruit_Thermal::printBarcode(const char *text, uint8_t type) {
-  feed(1); // Recent firmware can't print barcode w/o feed first???
+// Barcode module width, in dots (GS w): 2 to 6.  Default is 3.
+void Adafruit_Thermal::setBarcodeWidth(uint8_t val) {
+  if (val < 2)
+    val = 2;
+  else if (val > 6)
+    val = 6;
+  barcodeWidth = val; // Sent with the next barcode, if changed
+}
+
+// Check a barcode's length and character set against its symbology, and
+// estimate its width in (narrow) modules.  Returns 0 if it's not valid.
+// Types other than those in the barcodes enum aren't checked, and are
+// assumed to fit.
+static uint16_t barcodeModules(const char *text, size_t len, uint8_t type) {
+  size_t minLen = 1, maxLen = 255, i;
+  uint16_t modules;
+  const char *extra = NULL; // Allowed besides digits, or NULL for ASCII
+
+  switch (type) {
+  case UPC_A:
+  case EAN13:
+    minLen = (type == UPC_A) ? 11 : 12;
+    maxLen = minLen + 1;
+    extra = "";
+    modules = 95;
+    break;
+  case UPC_E:
+    if ((len == 9) || (len == 10))
+      return 0;
+    minLen = 6;
+    maxLen = 12;
+    extra = "";
+    modules = 51;
+    break;
+  case EAN8:
+    minLen = 7;
+    maxLen = 8;
+    extra = "";
+    modules = 67;
+    break;
+  case CODE39:
+    extra = "ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./";
+    modules = (len + 2) * 16; // Plus start/stop; wide bars ~3 modules
+    break;
+  case ITF:
+    if (len & 1)
+      return 0; // Digits are encoded in pairs
+    minLen = 2;
+    extra = "";
+    modules = len * 9 + 10;
+    break;
+  case CODABAR:
+    extra = "ABCDabcd$+-./:";
+    modules = (len + 2) * 12;
+    break;
+  case CODE93:
+    modules = (len + 4) * 9 + 1;
+    break;
+  case CODE128:
+    minLen = 2; // Includes code set selection
+    modules = (len + 3) * 11 + 2;
+    break;
+  default:
+    return (len >= 1) && (len <= 255) ? 1 : 0;
+  }
+
+  if ((len < minLen) || (len > maxLen))
+    return 0;
+  for (i = 0; i < len; i++) {
+    char c = text[i];
+    if (extra ? !(isdigit(c) || (c && strchr(extra, c)))
+              : ((uint8_t)c > 127))
+      return 0;
+  }
+  return modules;
+}
+
+// Prints a barcode, returning false (without printing anything) if the
+// text isn't valid for the barcode type.  Setup commands are
+// only issued when the setting differs from what the printer already
+// has, and the barcode itself goes out as a single burst.
+bool Adafruit_Thermal::printBarcode(const char *text, uint8_t type) {
+  size_t len = strlen(text);
+  uint16_t modules = barcodeModules(text, len, type), width;
+
+  if (!modules)
+    return false;
+  width = modules * barcodeWidth; // Approximate, in dots
+
+  if (column)
+    feed(1); // Firmware can't print barcode mid-line
+  if (skipOutput())
+    return true;
+  if (autoHeat)
+    setHeatClass(HEAT_DENSE); // Bars are half the width or so
   if (firmware >= 264)
     type += 65;
-  writeBytes(ASCII_GS, 'H', 2);    // Print label below barcode
-  writeBytes(ASCII_GS, 'w', 3);    // Barcode width 3 (0.375/1.0mm thin/thick)
-  writeBytes(ASCII_GS, 'k', type); // Barcode type (listed in .h file)
-  if (firmware >= 264) {
-    int len = strlen(text);
-    if (len > 255)
-      len = 255;
-    writeBytes(len); // Write length byte
-    for (uint8_t i = 0; i < len; i++)
-      writeBytes(text[i]); // Write string sans NUL
-  } else {
-    uint8_t c, i = 0;
-    do { // Copy string + NUL terminator
-      writeBytes(c = text[i++]);
-    } while (c);
+  if (!barcodeSent)
+    writeBytes(ASCII_GS, 'H', 2); // Print label below barcode
+  if (barcodeSent != barcodeWidth) {
+    writeBytes(ASCII_GS, 'w', barcodeWidth); // Module width, in dots
+    barcodeSent = barcodeWidth;
+  }
+
+  uint8_t cmd[] = {ASCII_GS, 'k', type, (uint8_t)len};
+  uint8_t n = (firmware >= 264) ? 4 : 3; // Older firmware: NUL-terminated
+  timeoutWait();
+  if (jobState == JOB_PAUSED)
+    return true; // (Found out while waiting)
+  stream->write(cmd, n);
+  stream->write((const uint8_t *)text, len);
+  if (firmware < 264) {
+    stream->write((uint8_t)0);
+    n++;
+  }
+  if (trace) {
+    unsigned long t = micros();
+    trace->add(TRACE_COMMAND, t,
+               cmd[0] | ((uint16_t)cmd[1] << 8) |
+                   ((unsigned long)cmd[2] << 16),
+               3);
+    trace->add(TRACE_WRITE, t, n - 3 + len);
   }
-  timeoutSet((barcodeHeight + 40) * dotPrintTime);
+
+  // Printing time for bars depends partly on how much of the head is
+  // heated: a full-width barcode row is costed like a text row, a narrow
+  // one at down to half that.  The label below adds about 40 rows.
+  if (width > 384)
+    width = 384;
+  timeoutSet((n + len) * byteTime +
+             barcodeHeight * ((dotPrintTime * (384UL + width)) / 768UL) +
+             40 * dotPrintTime);
   prevByte = '\n';
+  return true;
 }
 
 // === Character commands ===
@@ -328,6 +1052,7 @@ void Adafruit_Thermal::normal() {
 
 void Adafruit_Thermal::inverseOn() {
   if (firmware >= 268) {
+    rasterMode |= INVERSE_MASK;
     writeBytes(ASCII_GS, 'B', 1);
   } else {
     setPrintMode(INVERSE_MASK);
@@ -336,6 +1061,7 @@ void Adafruit_Thermal::inverseOn() {
 
 void Adafruit_Thermal::inverseOff() {
   if (firmware >= 268) {
+    rasterMode &= ~INVERSE_MASK;
     writeBytes(ASCII_GS, 'B', 0);
   } else {
     unsetPrintMode(INVERSE_MASK);
@@ -344,6 +1070,7 @@ void Adafruit_Thermal::inverseOff() {
 
 void Adafruit_Thermal::upsideDownOn() {
   if (firmware >= 268) {
+    rasterMode |= UPDOWN_MASK;
     writeBytes(ASCII_ESC, '{', 1);
   } else {
     setPrintMode(UPDOWN_MASK);
@@ -352,6 +1079,7 @@ void Adafruit_Thermal::upsideDownOn() {
 
 void Adafruit_Thermal::upsideDownOff() {
   if (firmware >= 268) {
+    rasterMode &= ~UPDOWN_MASK;
     writeBytes(ASCII_ESC, '{', 0);
   } else {
     unsetPrintMode(UPDOWN_MASK);
@@ -389,16 +1117,31 @@ void Adafruit_Thermal::justify(char value) {
     break;
   }
 
+  align = pos;
   writeBytes(ASCII_ESC, 'a', pos);
 }
 
 // Feeds by the specified number of lines
 void Adafruit_Thermal::feed(uint8_t x) {
-  if (firmware >= 264) {
-    writeBytes(ASCII_ESC, 'd', x);
-    timeoutSet(dotFeedTime * charHeight);
+  if (feedCoalesce) {
+    if (column && x) { // The first line feed ends the current text line
+      write('\n');
+      x--;
+    }
+    if (skipOutput())
+      return;
+    holdFeed((unsigned long)x * (24 + lineSpacing));
+    lines += x;
+  } else if (firmware >= 264) {
+    uint8_t cmd[] = {ASCII_ESC, 'd', x};
+    if (!skipOutput() && writeOutput(cmd, sizeof cmd)) {
+      // Prints any pending text line, then feeds x lines in all
+      timeoutSet((column ? charHeight * dotPrintTime : 0) +
+                 (unsigned long)x * (charHeight + lineSpacing) * dotFeedTime);
+    }
     prevByte = '\n';
     column = 0;
+    lines++;
   } else {
     while (x--)
       write('\n'); // Feed manually; old firmware feeds excess lines
@@ -407,13 +1150,67 @@ void Adafruit_Thermal::feed(uint8_t x) {
 
 // Feeds by the specified number of individual pixel rows
 void Adafruit_Thermal::feedRows(uint8_t rows) {
-  writeBytes(ASCII_ESC, 'J', rows);
+  if (skipOutput()) {
+    column = 0;
+  } else if (feedCoalesce && !column) {
+    holdFeed(rows);
+    lines++;
+  } else {
+    writeFeed(rows);
+  }
+}
+
+// Feed coalescing holds back paper feeds -- blank lines, feed(),
+// feedRows() and the blank rows around bitmaps -- as a count of dots, and
+// sends them as few ESC J commands as possible just before the next
+// output.  Each separate feed would otherwise cost a command and its own
+// rounded-up timing.
+void Adafruit_Thermal::setFeedCoalescing(bool enable) {
+  if (!enable)
+    flushFeed();
+  feedCoalesce = enable;
+}
+
+void Adafruit_Thermal::flushFeed() {
+  uint16_t n = pendingFeed;
+  pendingFeed = 0; // (writeFeed() calls back through timeoutWait())
+  while (n) {
+    uint8_t rows = (n > 255) ? 255 : n;
+    writeFeed(rows);
+    n -= rows;
+  }
+}
+
+// Adds dots to the feed held back.  Should the total outgrow pendingFeed
+// (some 8 m of paper, so only in a runaway loop of blank lines), whole
+// 255-dot feeds are sent now to make room, rather than letting it wrap.
+void Adafruit_Thermal::holdFeed(unsigned long dots) {
+  unsigned long n = pendingFeed + dots;
+  pendingFeed = 0; // (writeFeed() calls back through timeoutWait())
+  while (n > FEED_HOLD_MAX) {
+    writeFeed(255);
+    n -= 255;
+  }
+  pendingFeed = n;
+}
+
+void Adafruit_Thermal::writeFeed(uint8_t rows) {
+  uint8_t cmd[] = {ASCII_ESC, 'J', rows};
+  if (!writeOutput(cmd, sizeof cmd))
+    return;
+  if (autoTune && (rows >= TUNE_MIN_ROWS))
+    startTune(TUNE_FEED, rows, micros() + rows * dotFeedTime);
   timeoutSet(rows * dotFeedTime);
   prevByte = '\n';
   column = 0;
+  lines++;
 }
 
-void Adafruit_Thermal::flush() { writeBytes(ASCII_FF); }
+void Adafruit_Thermal::flush() {
+  uint8_t cmd[] = {ASCII_FF};
+  if (!skipOutput())
+    writeOutput(cmd, sizeof cmd);
+}
 
 void Adafruit_Thermal::setSize(char value) {
   uint8_t size;
@@ -465,6 +1262,7 @@ void Adafruit_Thermal::setSize(char value) {
 // but slower printing speed.
 void Adafruit_Thermal::setHeatConfig(uint8_t dots, uint8_t time,
                                      uint8_t interval) {
+  setHeatClass(HEAT_NONE); // (Until auto heat next switches)
   writeBytes(ASCII_ESC, '7');       // Esc 7 (print settings)
   writeBytes(dots, time, interval); // Heating dots, heat time, heat interval
 }
@@ -487,91 +1285,381 @@ void Adafruit_Thermal::setPrintDensity(uint8_t density, uint8_t breakTime) {
 void Adafruit_Thermal::underlineOn(uint8_t weight) {
   if (weight > 2)
     weight = 2;
+  underline = weight;
   writeBytes(ASCII_ESC, '-', weight);
 }
 
-void Adafruit_Thermal::underlineOff() { writeBytes(ASCII_ESC, '-', 0); }
+void Adafruit_Thermal::underlineOff() { underlineOn(0); }
+
+// Bitmap output is paced by a simple model of the printer's input buffer
+// rather than by waiting out each chunk.  Each row sent is assumed to
+// occupy the buffer until the head has printed it, and the head prints
+// one row every dotPrintTime once the row has arrived.  headTime tracks
+// when the head will finish everything sent so far; a new row is sent as
+// soon as the rows still pending fit in the buffer alongside it.  This
+// keeps the serial link busy while the head prints, and the head busy
+// while the next rows arrive, instead of alternating between the two.
+// The buffer size varies by printer model; see setBufferSize().
+//
+// On firmware 2.68 and later, bitmaps go out as a single GS v 0 raster
+// command, whose 16-bit row count needs no chunking; earlier firmware
+// gets DC2 * chunks of up to 255 rows.  GS v 0 can also scale the image
+// up (setBitmapScale()), which halves the data for the same size on
+// paper.  With DC2 * the library does the scaling itself, so the result
+// looks the same either way.
+static bool blankRow(const uint8_t *row, int n) {
+  while (n--) {
+    if (*row++)
+      return false;
+  }
+  return true;
+}
 
-void Adafruit_Thermal::printBitmap(int w, int h, const uint8_t *bitmap,
-                                   bool fromProgMem) {
-  int rowBytes, rowBytesClipped, rowStart, chunkHeight, chunkHeightLimit, x, y,
-      i;
+// True if an n-byte row, w dots per pixel across, is too dark for the
+// light heat profile.
+static bool denseRow(const uint8_t *row, int n, uint8_t w) {
+  uint16_t dots = 0;
+  while (n--) {
+    for (uint8_t b = *row++; b; b &= b - 1)
+      dots += w;
+    if (dots > HEAT_LIGHT_DOTS)
+      return true;
+  }
+  return false;
+}
 
-  rowBytes = (w + 7) / 8; // Round up to next byte boundary
-  rowBytesClipped = (rowBytes >= 48) ? 48 : rowBytes; // 384 pixels max width
+// Doubles each pixel of an n-byte row into out, for double-width
+// bitmaps on firmware without GS v 0.
+static const uint8_t *widenRow(const uint8_t *row, int n, uint8_t *out) {
+  for (int x = 0; x < n; x++) {
+    uint8_t in = row[x];
+    uint16_t wide = 0;
+    for (uint8_t b = 0; b < 8; b++) {
+      if (in & (0x80 >> b))
+        wide |= 0xC000 >> (2 * b);
+    }
+    out[2 * x] = wide >> 8;
+    out[2 * x + 1] = wide;
+  }
+  return out;
+}
 
-  // Est. max rows to write at once, assuming 256 byte printer buffer.
-  if (dtrEnabled) {
-    chunkHeightLimit = 255; // Buffer doesn't matter, handshake!
-  } else {
-    chunkHeightLimit = 256 / rowBytesClipped;
-    if (chunkHeightLimit > maxChunkHeight)
-      chunkHeightLimit = maxChunkHeight;
-    else if (chunkHeightLimit < 1)
+void Adafruit_Thermal::printBitmap(int w, int h, thermalRowFunc getRow,
+                                   void *ctx) {
+  uint8_t buf[THERMAL_MAX_ROW_BYTES], wide[THERMAL_MAX_ROW_BYTES];
+  const uint8_t *first = NULL; // Row already fetched, if any
+  bool raster = (firmware >= 268),
+      dense = false; // True if the chunk being sent has a dense row
+  uint8_t tall = (bitmapScale & BITMAP_DOUBLE_HEIGHT) ? 2 : 1,
+      across = (bitmapScale & BITMAP_DOUBLE_WIDTH) ? 2 : 1,
+      copies = raster ? 1 : tall; // Times each row is sent
+  int rowBytes, rowBytesClipped, sendBytes, rowStart, chunkHeight,
+      chunkHeightLimit, y, bufferRows, heldRows, reserve, top = 0, blank;
+  unsigned long rowTime = raster ? tall * dotPrintTime : dotPrintTime,
+      rowBase = jobRows; // Job position at row 0, in printJob()
+
+  if (jobState == JOB_PAUSED)
+    return;
+  if (jobState == JOB_REPLAY) {
+    // Resuming after paper out: rows printed before it are read (a row
+    // source may ignore y and just read on) but not sent.
+    if ((jobBytes < resumeBytes) || (rowBase + h < resumeRows))
+      top = h;
+    else if (resumeRows > rowBase)
+      top = resumeRows - rowBase;
+    for (y = 0; y < top; y++)
+      getRow(ctx, y, buf);
+    if ((jobBytes >= resumeBytes) && (rowBase + top >= resumeRows))
+      resumeJob();
+    if (top == h) {
+      jobRows = rowBase + h;
+      return;
+    }
+  }
+
+  rowBytes = (w + 7) / 8; // Round up to next byte boundary
+  rowBytesClipped = THERMAL_MAX_ROW_BYTES; // 384 pixels max width...
+  if (bitmapScale & BITMAP_DOUBLE_WIDTH)
+    rowBytesClipped /= 2; // ...after scaling
+  if (rowBytes < rowBytesClipped)
+    rowBytesClipped = rowBytes;
+  sendBytes = rowBytesClipped;
+  if (!raster && (bitmapScale & BITMAP_DOUBLE_WIDTH))
+    sendBytes *= 2;
+
+  // The buffer model (or DTR handshake) prevents overruns, so chunks
+  // need only respect the command's row count.
+  chunkHeightLimit = raster ? h : maxChunkHeight / copies;
+  if (chunkHeightLimit < 1)
+    chunkHeightLimit = 1;
+  // With auto heat, chunks are kept short so the profile can follow the
+  // image.  Each chunk is classed by its first row, the only one that
+  // can be looked at before the chunk's header goes out, and by the rows
+  // of the chunk before; a dark band is thus printed on the light
+  // profile for HEAT_CHUNK_ROWS - 1 rows at most.
+  if (autoHeat && (chunkHeightLimit > HEAT_CHUNK_ROWS))
+    chunkHeightLimit = HEAT_CHUNK_ROWS;
+  // In printJob(), chunks are kept short enough for the paper checks
+  // between them to come round every PAPER_CHECK_INTERVAL or so.
+  if ((jobState == JOB_RUN) && !ring &&
+      ((long)chunkHeightLimit * rowTime > PAPER_CHECK_INTERVAL * 1000L)) {
+    chunkHeightLimit = PAPER_CHECK_INTERVAL * 1000L / rowTime;
+    if (chunkHeightLimit < 1)
       chunkHeightLimit = 1;
   }
 
-  for (i = rowStart = 0; rowStart < h; rowStart += chunkHeightLimit) {
+  // Rows the printer can hold while another is printing.  The bytes
+  // sent between chunks (the header, with auto heat an ESC 7, and in
+  // printJob() a paper check) take room too: one lot in full, as a row
+  // may wait behind one, plus a share per row for chunks short enough
+  // that several are buffered at once.
+  reserve = raster ? 8 : 4;
+  if (autoHeat)
+    reserve += HEAT_RESERVE;
+  if ((jobState == JOB_RUN) && (chunkHeightLimit < h))
+    reserve += 3; // ESC v 0 or GS r 0
+  bufferRows = ((long)bufferSize - reserve) * chunkHeightLimit * copies /
+               ((long)sendBytes * chunkHeightLimit * copies + reserve);
+  // A paper check is answered only once the rows buffered ahead of it
+  // have printed, so in printJob() they're kept to what prints in half
+  // of STATUS_TIMEOUT, or the reply would be given up on.  (The head is
+  // kept just as busy; only the link runs less far ahead of it.)
+  if ((jobState == JOB_RUN) &&
+      ((long)bufferRows * rowTime > STATUS_TIMEOUT * 500L))
+    bufferRows = STATUS_TIMEOUT * 500L / rowTime;
+  if (bufferRows < 1)
+    bufferRows = 1;
+  heldRows = bufferRows;
+
+  // With feed coalescing, blank rows at the top are fed instead of sent
+  // (unless rows of the same bitmap are still printing ahead of them).
+  if (feedCoalesce && !column && !bandCont) {
+    for (blank = top; top < h; top++) {
+      first = getRow(ctx, top, buf);
+      if (!blankRow(first, rowBytesClipped))
+        break;
+    }
+    holdFeed((unsigned long)(top - blank) * tall);
+    if (top == h) {
+      jobRows = rowBase + h;
+      return;
+    }
+  }
+
+  // (service() keeps its own head time in ring mode.)  Rows still due
+  // to print, e.g. from printBand(), are queued behind.
+  if (!ring && ((long)(headTime - now()) < 0L))
+    headTime = now();
+  for (rowStart = top; rowStart < h; rowStart += chunkHeight) {
+    if (rowStart > top) { // Between chunks
+      jobRows = rowBase + rowStart;
+      checkPaper(false);
+      if (jobState == JOB_PAUSED)
+        break;
+    }
+
     // Issue up to chunkHeightLimit rows at a time:
     chunkHeight = h - rowStart;
     if (chunkHeight > chunkHeightLimit)
       chunkHeight = chunkHeightLimit;
 
-    writeBytes(ASCII_DC2, '*', chunkHeight, rowBytesClipped);
+    if (autoHeat) {
+      if (!first)
+        first = getRow(ctx, rowStart, buf);
+      if (!dense)
+        dense = denseRow(first, rowBytesClipped, across);
+      setHeatClass(dense ? HEAT_DENSE : HEAT_LIGHT);
+      rowTime = raster ? tall * dotPrintTime : dotPrintTime;
+      // Rows still buffered may be light ones, which print faster than
+      // this chunk's; the buffer is counted in those so it can't overfill.
+      heldRows = bufferRows;
+      if (dense)
+        heldRows = (long)bufferRows * heatScale(HEAT_LIGHT) /
+                   heatScale(HEAT_DENSE);
+      if (heldRows < 1)
+        heldRows = 1;
+      dense = false;
+    }
+
+    if (trace)
+      trace->add(TRACE_CHUNK, micros(), chunkHeight * copies, sendBytes);
+    if (raster) {
+      writeBytes(ASCII_GS, 'v', '0', bitmapScale);
+      writeBytes(sendBytes, 0, chunkHeight, chunkHeight >> 8);
+    } else {
+      writeBytes(ASCII_DC2, '*', chunkHeight * copies, sendBytes);
+    }
 
     for (y = 0; y < chunkHeight; y++) {
-      for (x = 0; x < rowBytesClipped; x++, i++) {
+      const uint8_t *row = first ? first : getRow(ctx, rowStart + y, buf);
+      first = NULL;
+      if (autoHeat && !dense)
+        dense = denseRow(row, rowBytesClipped, across);
+      if (sendBytes > rowBytesClipped)
+        row = widenRow(row, rowBytesClipped, wide);
+      for (uint8_t c = 0; c < copies; c++) {
+        // Wait for the link, and for room in the printer's buffer.  (The
+        // printer signals DTR busy with room to spare, so with
+        // handshaking a whole row can go out once it's ready.)
+        if (ring) {
+          if (!dtrEnabled)
+            ring->pushRow(heldRows, rowTime); // service() waits
+        } else if (!dtrEnabled) {
+          rowWait(heldRows, rowTime);
+        }
         timeoutWait();
-        stream->write(fromProgMem ? pgm_read_byte(bitmap + i) : *(bitmap + i));
+        if (jobState == JOB_PAUSED) { // (Found out while waiting)
+          // The chunk's command is already out, so finish it with blank
+          // rows rather than print any more of the job.
+          for (int i = 0; i < sendBytes; i++)
+            wide[i] = 0;
+          row = wide;
+        }
+        stream->write(row, sendBytes);
+        if (trace)
+          trace->add(TRACE_WRITE, micros(), sendBytes);
+        if (!ring && !dtrEnabled)
+          rowSent(sendBytes, rowTime);
       }
-      i += rowBytes - rowBytesClipped;
     }
-    timeoutSet(chunkHeight * dotPrintTime);
+  }
+  if (bandMore) {
+    // More rows follow: the next band waits only for room in the buffer
+    if (!ring && !dtrEnabled)
+      rowWait(heldRows, rowTime);
+  } else if (ring) {
+    ring->pushSync(); // Subsequent commands wait for the head to finish
+  } else if (!dtrEnabled) {
+    if (autoTune && ((long)h * tall >= TUNE_MIN_ROWS) &&
+        (dotPrintTime > sendBytes * byteTime)) // Print-bound only
+      startTune(TUNE_PRINT, (uint16_t)h * tall, headTime);
+    // Subsequent commands wait for the head to finish:
+    if ((long)(headTime - now()) > 0L)
+      timeoutSet(headTime - now());
   }
   prevByte = '\n';
+  jobRows = rowBase + h;
+  checkPaper(false);
 }
 
-void Adafruit_Thermal::printBitmap(int w, int h, Stream *fromStream) {
-  int rowBytes, rowBytesClipped, rowStart, chunkHeight, chunkHeightLimit, x, y,
-      i, c;
+// Bitmap row pacing, used by printBitmap() and by service() in ring
+// mode.  Before a row: wait until the rows still pending leave room for
+// it in the printer's buffer.
+void Adafruit_Thermal::rowWait(uint16_t bufferRows, unsigned long rowTime) {
+  unsigned long t = headTime - (unsigned long)bufferRows * rowTime;
+  if ((long)(t - resumeTime) > 0L)
+    resumeTime = t;
+}
 
-  rowBytes = (w + 7) / 8; // Round up to next byte boundary
-  rowBytesClipped = (rowBytes >= 48) ? 48 : rowBytes; // 384 pixels max width
+// After a row of n bytes: the head prints it once it has fully arrived
+// and the rows ahead of it are done.
+void Adafruit_Thermal::rowSent(uint8_t n, unsigned long rowTime) {
+  unsigned long t = now() + n * byteTime; // Row fully received
+  if ((long)(t - headTime) > 0L)
+    headTime = t;
+  headTime += rowTime;
+  resumeTime = t;
+}
 
-  // Est. max rows to write at once, assuming 256 byte printer buffer.
-  if (dtrEnabled) {
-    chunkHeightLimit = 255; // Buffer doesn't matter, handshake!
-  } else {
-    chunkHeightLimit = 256 / rowBytesClipped;
-    if (chunkHeightLimit > maxChunkHeight)
-      chunkHeightLimit = maxChunkHeight;
-    else if (chunkHeightLimit < 1)
-      chunkHeightLimit = 1;
-  }
+// Row source for RAM- and PROGMEM-resident bitmaps.  RAM rows are
+// passed straight through without copying.
+struct memBitmap {
+  const uint8_t *data;
+  int rowBytes;
+  bool fromProgMem;
+};
+
+static const uint8_t *memBitmapRow(void *ctx, int y, uint8_t *buf) {
+  memBitmap *b = (memBitmap *)ctx;
+  const uint8_t *row = b->data + (long)y * b->rowBytes;
+  if (!b->fromProgMem)
+    return row;
+  memcpy_P(buf, row,
+           (b->rowBytes < THERMAL_MAX_ROW_BYTES) ? b->rowBytes
+                                                 : THERMAL_MAX_ROW_BYTES);
+  return buf;
+}
 
-  for (rowStart = 0; rowStart < h; rowStart += chunkHeightLimit) {
-    // Issue up to chunkHeightLimit rows at a time:
-    chunkHeight = h - rowStart;
-    if (chunkHeight > chunkHeightLimit)
-      chunkHeight = chunkHeightLimit;
+void Adafruit_Thermal::printBitmap(int w, int h, const uint8_t *bitmap,
+                                   bool fromProgMem) {
+  memBitmap b = {bitmap, (w + 7) / 8, fromProgMem};
+  int bottom = 0;
+
+  // Rows are randomly accessible here, so blank rows can be trimmed from
+  // the bottom as well as the top.
+  if (feedCoalesce && !column) {
+    uint8_t buf[THERMAL_MAX_ROW_BYTES];
+    int n = (b.rowBytes < THERMAL_MAX_ROW_BYTES) ? b.rowBytes
+                                                 : THERMAL_MAX_ROW_BYTES;
+    while ((bottom < h) &&
+           blankRow(memBitmapRow(&b, h - 1 - bottom, buf), n))
+      bottom++;
+  }
+  printBitmap(w, h - bottom, memBitmapRow, &b);
+  if (!skipOutput())
+    holdFeed((bitmapScale & BITMAP_DOUBLE_HEIGHT) ? 2UL * bottom : bottom);
+}
 
-    writeBytes(ASCII_DC2, '*', chunkHeight, rowBytesClipped);
+// One step of a bitmap for Adafruit_ThermalPool: as many of the h rows
+// as take maxBytes on the way out (at least one), which is as much as
+// can go without waiting on the link (or, in ring mode, the room left in
+// the ring).  Unless they're the last, the rows aren't waited out: the
+// next band follows as soon as the printer's buffer has room for it, so
+// the bands print back to back.  cont is true for all but the first band
+// of a bitmap.  Returns the number of rows sent.
+int Adafruit_Thermal::printBand(int w, int h, const uint8_t *bitmap,
+                                bool fromProgMem, uint16_t maxBytes,
+                                bool cont) {
+  memBitmap b = {bitmap, (w + 7) / 8, fromProgMem};
+  int n = (b.rowBytes < THERMAL_MAX_ROW_BYTES) ? b.rowBytes
+                                               : THERMAL_MAX_ROW_BYTES,
+      header = 8, rows;
+
+  if (firmware < 268) { // DC2 * scales by sending more
+    header = 4;
+    if (bitmapScale & BITMAP_DOUBLE_WIDTH)
+      n = 2 * ((n < THERMAL_MAX_ROW_BYTES / 2) ? n : THERMAL_MAX_ROW_BYTES / 2);
+    if (bitmapScale & BITMAP_DOUBLE_HEIGHT)
+      n *= 2;
+  }
+  if (ring) // Each row also takes a RING_ROW and a run header
+    rows = ((int)maxBytes - 4 * header) / (n + 8);
+  else
+    rows = ((int)maxBytes - header) / n;
+  if (rows < 1)
+    rows = 1;
+  if (rows > h)
+    rows = h;
+
+  bandMore = (rows < h);
+  bandCont = cont;
+  printBitmap(w, rows, memBitmapRow, &b);
+  bandMore = bandCont = false;
+  return rows;
+}
 
-    for (y = 0; y < chunkHeight; y++) {
-      for (x = 0; x < rowBytesClipped; x++) {
-        while ((c = fromStream->read()) < 0)
-          ;
-        timeoutWait();
-        stream->write((uint8_t)c);
-      }
-      for (i = rowBytes - rowBytesClipped; i > 0; i--) {
-        while ((c = fromStream->read()) < 0)
-          ;
-      }
-    }
-    timeoutSet(chunkHeight * dotPrintTime);
+// Row source for bitmaps read from a Stream.  Bytes beyond the printable
+// width are read and discarded.
+struct streamBitmap {
+  Stream *stream;
+  int rowBytes;
+};
+
+static const uint8_t *streamBitmapRow(void *ctx, int /*y*/, uint8_t *buf) {
+  streamBitmap *b = (streamBitmap *)ctx;
+  int x, c;
+  for (x = 0; x < b->rowBytes; x++) {
+    while ((c = b->stream->read()) < 0)
+      ;
+    if (x < THERMAL_MAX_ROW_BYTES)
+      buf[x] = c;
   }
-  prevByte = '\n';
+  return buf;
+}
+
+void Adafruit_Thermal::printBitmap(int w, int h, Stream *fromStream) {
+  streamBitmap b = {fromStream, (w + 7) / 8};
+  printBitmap(w, h, streamBitmapRow, &b);
 }
 
 void Adafruit_Thermal::printBitmap(Stream *fromStream) {
@@ -587,6 +1675,47 @@ void Adafruit_Thermal::printBitmap(Stream *fromStream) {
   printBitmap(width, height, fromStream);
 }
 
+#if !defined(ARDUINO) && defined(__linux__)
+// Host builds on Linux: the file is mapped into memory and its rows go
+// straight from the mapping to the printer through the RAM bitmap path,
+// with no read() calls or copies.  The kernel is told access is
+// sequential, so it reads ahead and drops pages behind for files much
+// bigger than memory (long banners).  The file's size is taken when it's
+// opened: rows beyond it, including a partial last row, aren't printed.
+// (As with any mapping, the file mustn't be truncated while printing.)
+bool Adafruit_Thermal::printBitmapFile(const char *path) {
+  struct stat st;
+  const uint8_t *data;
+  void *map;
+  int fd, w, h, rows, rowBytes;
+
+  if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+    return false;
+  if ((fstat(fd, &st) < 0) || (st.st_size < 4)) {
+    close(fd);
+    return false;
+  }
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // The mapping holds its own reference
+  if (map == MAP_FAILED)
+    return false;
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+  data = (const uint8_t *)map;
+  w = data[0] | (data[1] << 8);
+  h = data[2] | (data[3] << 8);
+  rowBytes = (w + 7) / 8;
+  rows = h;
+  if (rowBytes && ((st.st_size - 4) / rowBytes < h))
+    rows = (st.st_size - 4) / rowBytes;
+  if (rows)
+    printBitmap(w, rows, data + 4, false);
+
+  munmap(map, st.st_size);
+  return rows == h;
+}
+#endif
+
 // Take the printer offline. Print commands sent after this will be
 // ignored until 'online' is called.
 void Adafruit_Thermal::offline() { writeBytes(ASCII_ESC, '=', 0); }
@@ -600,22 +1729,52 @@ void Adafruit_Thermal::sleep() {
 }
 
 // Put the printer into a low-energy state after the given number
-// of seconds.
+// of seconds.  The library keeps track of the timer (restarted by every
+// byte sent) so that wake() knows whether it's needed.
 void Adafruit_Thermal::sleepAfter(uint16_t seconds) {
   if (firmware >= 264) {
     writeBytes(ASCII_ESC, '8', seconds, seconds >> 8);
   } else {
     writeBytes(ASCII_ESC, '8', seconds);
+    seconds &= 0xFF;
   }
+  sleepSeconds = seconds;
+  sleepKnown = true;
+}
+
+// True unless the printer is known to be awake: sleep switched off, or
+// sleepAfter()'s timer not yet (nearly) run out since the last byte sent.
+bool Adafruit_Thermal::mightSleep() {
+  if (!sleepKnown)
+    return true; // Left asleep by an earlier sketch, perhaps
+  if (!sleepSeconds)
+    return false;
+  return (millis() - lastActivity) + SLEEP_MARGIN >= sleepSeconds * 1000UL;
 }
 
-// Wake the printer from a low-energy state.
+// Wake the printer from a low-energy state.  Does nothing if the printer
+// can't have gone to sleep yet, so it's cheap to call before every job.
+// Doesn't wait for the printer to come round either: the settle time is
+// scheduled like any other, and the rest of the wake sequence is sent
+// ahead of the next output, once that time has passed.
 void Adafruit_Thermal::wake() {
+  if (!mightSleep())
+    return;
   timeoutSet(0);   // Reset timeout counter
   writeBytes(255); // Wake
+  if (firmware >= 264)
+    settle(50000L);
+  wakePending = true;
+}
+
+// Second half of wake(), called from timeoutWait() ahead of the next
+// output.
+void Adafruit_Thermal::finishWake() {
+  wakePending = false; // (writeBytes() calls back through timeoutWait())
   if (firmware >= 264) {
-    delay(50);
     writeBytes(ASCII_ESC, '8', 0, 0); // Sleep off (important!)
+    sleepSeconds = 0;
+    sleepKnown = true;
   } else {
     // Datasheet recommends a 50 mS delay before issuing further commands,
     // but in practice this alone isn't sufficient (e.g. text size/style
@@ -623,31 +1782,308 @@ void Adafruit_Thermal::wake() {
     // delay, interspersed with NUL chars (no-ops) seems to help.
     for (uint8_t i = 0; i < 10; i++) {
       writeBytes(0);
-      timeoutSet(10000L);
+      settle(10000L);
     }
   }
 }
 
 // Check the status of the paper using the printer's self reporting
-// ability.  Returns true for paper, false for no paper.
-// Might not work on all printers!
+// ability.  Returns true for paper, false for no paper.  Blocks until
+// the printer replies or STATUS_TIMEOUT elapses; if the printer never
+// answers, paper is assumed present (rather than misreading the missing
+// reply as a status byte).  See requestStatus() for a non-blocking
+// alternative.  Might not work on all printers!
 bool Adafruit_Thermal::hasPaper() {
-  if (firmware >= 264) {
-    writeBytes(ASCII_ESC, 'v', 0);
+  requestStatus();
+  while (statusPending) {
+    collectStatus();
+    yield();
+  }
+  return paperState != PAPER_OUT;
+}
+
+// Issue a status query and return immediately (after any wait for the
+// printer to finish the prior task, as with other commands).  The reply
+// is collected by poll() or while the library waits for the printer;
+// check paperStatus() afterward.  Does nothing if a query is already
+// outstanding.
+void Adafruit_Thermal::requestStatus() {
+  if (statusPending)
+    return;
+  while (stream->available())
+    stream->read(); // Discard stale bytes so they're not taken as a reply
+  writeStatusQuery();
+  if (estimating)
+    return; // Dry run: no reply to wait for
+  statusQueryTime = millis();
+  lastCollect = micros();
+  statusPending = true;
+}
+
+// Automatic timing adjustment.  The printer answers a status query only
+// once it has worked through everything ahead of the query in its
+// buffer, so a query issued right after a bitmap or feed is answered
+// when the paper has actually stopped moving.  Comparing that against
+// the time the timing model predicted gives the per-row error, which is
+// folded back into dotPrintTime or dotFeedTime: gradually when the
+// printer was faster than modeled, and immediately (plus a margin) when
+// it was slower, since that risks overrunning the buffer.  Replies that
+// weren't collected promptly (e.g. the sketch went off to do something
+// else) give no useful timing and are ignored.  Tuned values can be read
+// with getTimes() and saved, e.g. to EEPROM, then restored after begin()
+// with setTimes().  Has no effect with DTR handshaking, which doesn't use
+// the timing model.
+void Adafruit_Thermal::setAutoTune(bool enable) { autoTune = enable; }
+
+// Automatic heat profiles.  No one heat setting suits everything: more
+// heating dots at once and a shorter heat time print sparse rows faster,
+// but dense rows then fade, or draw more current than the supply gives.
+// With auto heat, plain text lines and bitmap chunks with few black dots
+// are printed on a faster light profile; bold, inverse and double-width
+// text, barcodes and darker bitmap chunks on begin()'s settings; and the
+// print time used for pacing follows.  The ESC 7 setting is sent only
+// when the class changes.  Bitmap rows are fetched once, in order (a
+// Stream can't be read twice), so a chunk is classed by its first row
+// and the rows before it: a dark band starting partway through a chunk
+// prints on the light profile for up to HEAT_CHUNK_ROWS - 1 rows, and
+// may fade there.  Calling setHeatConfig() overrides the profile until
+// auto heat next switches.
+void Adafruit_Thermal::setAutoHeat(bool enable) {
+  autoHeat = enable;
+  if (!enable && (heatClass == HEAT_LIGHT))
+    setHeatClass(HEAT_DENSE); // Back to begin()'s settings
+}
+
+// Heat class for text in the current style: light unless bold, inverse
+// or double width, which ink several times the dots.
+uint8_t Adafruit_Thermal::textHeat() {
+  return ((printMode & (INVERSE_MASK | BOLD_MASK | DOUBLE_WIDTH_MASK)) ||
+          (rasterMode & INVERSE_MASK))
+             ? HEAT_DENSE
+             : HEAT_LIGHT;
+}
+
+// Puts the printer on the heat profile for a class of content, and the
+// print time with it, unless it's there already.  HEAT_NONE just notes
+// that the printer's settings were changed some other way; print times
+// go back to those for begin()'s settings.
+void Adafruit_Thermal::setHeatClass(uint8_t c) {
+  if (c == heatClass)
+    return;
+  if (c != HEAT_NONE) {
+    writeBytes(ASCII_ESC, '7');
+    writeBytes(pgm_read_byte(&heatProfiles[c][0]),
+               pgm_read_byte(&heatProfiles[c][1]),
+               pgm_read_byte(&heatProfiles[c][2]));
+  }
+  dotPrintTime = dotPrintTime * heatScale(c) / heatScale(heatClass);
+  heatClass = c;
+}
+
+// Retrieve the current print and feed times, e.g. after auto tuning.
+void Adafruit_Thermal::getTimes(unsigned long *p, unsigned long *f) {
+  *p = dotPrintTime;
+  *f = dotFeedTime;
+}
+
+// Issue a status query right behind a just-sent bitmap or feed of the
+// given number of rows, predicted to finish at time 'end'.
+void Adafruit_Thermal::startTune(uint8_t kind, uint16_t rows,
+                                 unsigned long end) {
+  if (statusPending)
+    return; // Reply to an earlier query not in yet, skip this sample
+  requestStatus();
+  tuneKind = kind;
+  tuneRows = rows;
+  tuneEnd = end + byteTime; // Plus time for the reply byte itself
+}
+
+void Adafruit_Thermal::tuneTimes(unsigned long replyTime) {
+  unsigned long *t = (tuneKind == TUNE_PRINT) ? &dotPrintTime : &dotFeedTime;
+  long err = (long)(replyTime - tuneEnd) / (long)tuneRows; // Per row
+
+  if (err > 0) {
+    *t += err + (*t >> 4); // Slower than modeled: back off right away
   } else {
-    writeBytes(ASCII_GS, 'r', 0);
+    err /= 4; // Faster than modeled: converge gradually
+    *t = ((long)*t + err > TUNE_MIN_TIME) ? *t + err : TUNE_MIN_TIME;
   }
+}
 
-  int status = -1;
-  for (uint8_t i = 0; i < 10; i++) {
-    if (stream->available()) {
-      status = stream->read();
-      break;
+// Collect an outstanding status reply, if one has arrived.  Sketches
+// using requestStatus() should call this periodically from loop().
+void Adafruit_Thermal::poll() { collectStatus(); }
+
+// Paper state from the most recent status reply: PAPER_PRESENT,
+// PAPER_OUT, or PAPER_UNKNOWN if never queried or the last query went
+// unanswered.
+uint8_t Adafruit_Thermal::paperStatus() { return paperState; }
+
+// Raw byte from the most recent status reply, or -1 if none.
+int Adafruit_Thermal::statusByte() {
+  return (paperState == PAPER_UNKNOWN) ? -1 : lastStatus;
+}
+
+// millis() value when paperStatus() was last updated (reply or timeout).
+unsigned long Adafruit_Thermal::statusTime() { return statusUpdateTime; }
+
+// Register a function to be called whenever the paper state changes
+// between present and out, e.g. to pause a job queue.  Pass NULL to
+// disable.
+void Adafruit_Thermal::setPaperCallback(void (*callback)(bool hasPaper)) {
+  paperCallback = callback;
+}
+
+void Adafruit_Thermal::collectStatus() {
+  if (!statusPending)
+    return;
+
+  unsigned long now = micros();
+  bool prompt = (now - lastCollect) < TUNE_MAX_LATENCY;
+  lastCollect = now;
+
+  if (stream->available()) {
+    uint8_t prevStatus = lastStatus; // Initially 0 (paper present)
+    lastStatus = stream->read();
+    paperState = (lastStatus & 0b00000100) ? PAPER_OUT : PAPER_PRESENT;
+    if (jobQuery && (jobState == JOB_RUN)) {
+      if (paperState == PAPER_OUT) {
+        pauseJob();
+      } else { // Everything before the query printed
+        resumeBytes = queryBytes;
+        resumeRows = queryRows;
+      }
     }
-    delay(100);
+    if (paperCallback && ((lastStatus ^ prevStatus) & 0b00000100))
+      paperCallback(paperState == PAPER_PRESENT);
+    if (tuneKind && prompt)
+      tuneTimes(now);
+  } else if ((millis() - statusQueryTime) >= STATUS_TIMEOUT) {
+    paperState = PAPER_UNKNOWN;
+  } else {
+    return; // Still waiting
+  }
+
+  statusPending = false;
+  jobQuery = false;
+  statusUpdateTime = millis();
+  tuneKind = 0;
+}
+
+// printJob() keeps its place by counting what the job prints: bytes of
+// text and bitmap rows.  Between lines and between bitmap chunks, the
+// paper is checked (every PAPER_CHECK_INTERVAL, as a status reply takes
+// as long to come back as the printer takes to get through what's
+// buffered ahead of the query).  A reply of paper present means all that
+// went before the query is on paper, so the count at the query becomes
+// the point to resume from.  A reply of paper out drops the rest of the
+// job: text, bitmap rows, feeds and barcodes are discarded until it
+// returns.  Resuming runs the job again from the start with the style it
+// began with, dropping output up to the resume point; commands setting
+// the style still go out on the way, and the style tracked by the
+// library is sent again on arrival, in case paper out left the printer
+// in a later one.  The stretch between the last good check and the paper
+// running out is printed a second time, rather than risk losing any.
+bool Adafruit_Thermal::printJob(thermalJobFunc job, void *ctx) {
+  if (jobHeld) {
+    if (!hasPaper())
+      return false;
+    if (errorCode == THERMAL_PAPER_OUT)
+      errorCode = THERMAL_OK;
+    printMode = jobStyle.printMode;
+    adjustCharValues(printMode);
+    lineSpacing = jobStyle.lineSpacing;
+    align = jobStyle.align;
+    underline = jobStyle.underline;
+    rasterMode = jobStyle.rasterMode;
+    barcodeHeight = jobStyle.barcodeHeight;
+    column = jobStyle.column;
+    setHeatClass(HEAT_NONE); // Profile is sent again when next needed
+    jobState = JOB_REPLAY;
+  } else {
+    jobStyle.printMode = printMode;
+    jobStyle.lineSpacing = lineSpacing;
+    jobStyle.align = align;
+    jobStyle.underline = underline;
+    jobStyle.rasterMode = rasterMode;
+    jobStyle.barcodeHeight = barcodeHeight;
+    jobStyle.column = column;
+    resumeBytes = resumeRows = 0;
+    jobState = JOB_RUN;
+  }
+  jobBytes = jobRows = 0;
+  if ((jobState == JOB_REPLAY) && !resumeBytes && !resumeRows)
+    resumeJob(); // Nothing printed the first time
+
+  job(this, ctx);
+
+  // A last check covers the end of the job.
+  while (statusPending) {
+    collectStatus();
+    idle();
   }
+  checkPaper(true);
+  while (statusPending) {
+    collectStatus();
+    idle();
+  }
+  jobHeld = (jobState == JOB_PAUSED);
+  jobState = JOB_NONE;
+  if (lineHeld) {
+    // Text sent before the paper out showed would otherwise stay in the
+    // printer's line buffer, and be printed ahead of the resumed job.
+    writeBytes(ASCII_LF);
+    lineHeld = false;
+  }
+  return !jobHeld;
+}
 
-  return !(status & 0b00000100);
+// Position a held printJob() will resume from: bytes of text, and bitmap
+// rows, printed before the paper ran out.
+unsigned long Adafruit_Thermal::checkpointOffset() { return resumeBytes; }
+
+unsigned long Adafruit_Thermal::checkpointRow() { return resumeRows; }
+
+// Job check; force skips the interval, for the end of the job.
+void Adafruit_Thermal::checkPaper(bool force) {
+  if ((jobState != JOB_RUN) || statusPending || ring || estimating)
+    return;
+  if (!force && ((millis() - statusQueryTime) < PAPER_CHECK_INTERVAL))
+    return;
+  queryBytes = jobBytes;
+  queryRows = jobRows;
+  requestStatus();
+  jobQuery = statusPending;
+}
+
+// Paper out: pending feed was held back after the check, so it goes too.
+void Adafruit_Thermal::pauseJob() {
+  jobState = JOB_PAUSED;
+  errorCode = THERMAL_PAPER_OUT;
+  pendingFeed = 0;
+  lineHeld = (column != 0);
+}
+
+// The replay has reached the resume point: the style is sent again.
+void Adafruit_Thermal::resumeJob() {
+  jobState = JOB_RUN;
+  writePrintMode();
+  writeBytes(ASCII_ESC, '3', 24 + lineSpacing);
+  writeBytes(ASCII_ESC, 'a', align);
+  writeBytes(ASCII_ESC, '-', underline);
+  if (firmware >= 268) {
+    writeBytes(ASCII_GS, 'B', (rasterMode & INVERSE_MASK) ? 1 : 0);
+    writeBytes(ASCII_ESC, '{', (rasterMode & UPDOWN_MASK) ? 1 : 0);
+  }
+  writeBytes(ASCII_GS, 'h', barcodeHeight);
+  barcodeSent = 0; // Label and width too
+  prevByte = '\n';
+}
+
+// True if paper-moving output is to be dropped: a printJob() that's
+// replaying up to its resume point, or out of paper.
+bool Adafruit_Thermal::skipOutput() {
+  return (jobState == JOB_REPLAY) || (jobState == JOB_PAUSED);
 }
 
 void Adafruit_Thermal::setLineHeight(int val) {
@@ -662,7 +2098,27 @@ void Adafruit_Thermal::setLineHeight(int val) {
   writeBytes(ASCII_ESC, '3', val);
 }
 
-void Adafruit_Thermal::setMaxChunkHeight(int val) { maxChunkHeight = val; }
+// Scales bitmaps up on paper: BITMAP_DOUBLE_WIDTH, BITMAP_DOUBLE_HEIGHT
+// or BITMAP_QUADRUPLE (both), or BITMAP_NORMAL.  Rows are clipped to 192
+// pixels when doubled in width.
+void Adafruit_Thermal::setBitmapScale(uint8_t scale) {
+  bitmapScale = scale & BITMAP_QUADRUPLE;
+}
+
+void Adafruit_Thermal::setMaxChunkHeight(int val) {
+  if (val > 255)
+    val = 255; // DC2 * row count is a single byte
+  else if (val < 1)
+    val = 1;
+  maxChunkHeight = val;
+}
+
+// Size of the printer's input buffer, in bytes.  Used to pace bitmap
+// output; the default of 256 suits the common Adafruit units, but other
+// printer models may have more (faster streaming) or less.
+void Adafruit_Thermal::setBufferSize(uint16_t bytes) {
+  bufferSize = bytes ? bytes : 1;
+}
 
 // These commands work only on printers w/recent firmware ------------------
 
@@ -681,7 +2137,8 @@ void Adafruit_Thermal::setCodePage(uint8_t val) {
 }
 
 void Adafruit_Thermal::tab() {
-  writeBytes(ASCII_TAB);
+  if (!skipOutput())
+    writeBytes(ASCII_TAB);
   column = (column + 4) & 0b11111100;
 }
 
@@ -7,6 +7,11 @@
 
 #include "Arduino.h"
 
+// Optional modules, used by pointer only; a sketch using one includes
+// its header (e.g. Adafruit_ThermalRing.h) itself.
+class Adafruit_ThermalRing;
+class Adafruit_ThermalTrace;
+
 // Internal character sets used with ESC R n
 #define CHARSET_USA 0           //!< American character set
 #define CHARSET_FRANCE 1        //!< French character set
@@ -77,7 +82,7 @@
  */
 enum barcodes {
   UPC_A,   /**< UPC-A barcode system. 11-12 char */
-  UPC_E,   /**< UPC-E barcode system. 11-12 char */
+  UPC_E,   /**< UPC-E barcode system. 6-8 or 11-12 char */
   EAN13,   /**< EAN13 (JAN13) barcode system. 12-13 char */
   EAN8,    /**< EAN8 (JAN8) barcode system. 7-8 char */
   CODE39,  /**< CODE39 barcode system. 1<=num of chars */
@@ -87,6 +92,53 @@ enum barcodes {
   CODE128, /**< CODE128 barcode system. 2<=num<=255 */
 };
 
+#define THERMAL_MAX_ROW_BYTES 48 //!< Bytes per bitmap row (384 dots) max
+
+/*!
+ * Bitmap scaling for setBitmapScale(), as used by GS v 0
+ */
+enum bitmapScales {
+  BITMAP_NORMAL,        /**< One dot per pixel */
+  BITMAP_DOUBLE_WIDTH,  /**< Two dots across per pixel */
+  BITMAP_DOUBLE_HEIGHT, /**< Two dots down per pixel */
+  BITMAP_QUADRUPLE,     /**< Two dots across and two down per pixel */
+};
+
+/*!
+ * Bitmap row source for printBitmap(): returns a pointer to row y (at
+ * least the first THERMAL_MAX_ROW_BYTES bytes of it), either within the
+ * source's own data or after filling buf, which holds that many bytes.
+ * Rows are requested in order, top to bottom.
+ */
+typedef const uint8_t *(*thermalRowFunc)(void *ctx, int y, uint8_t *buf);
+
+class Adafruit_Thermal;
+
+/*!
+ * Job for estimate() or printJob(): prints to the printer it's passed,
+ * just as it would when printing for real.  For printJob() it must print
+ * the same output each time it's run.
+ */
+typedef void (*thermalJobFunc)(Adafruit_Thermal *printer, void *ctx);
+
+/*!
+ * Paper states reported by paperStatus()
+ */
+enum paperStates {
+  PAPER_UNKNOWN, /**< No status reply received (yet) */
+  PAPER_PRESENT, /**< Printer reported paper present */
+  PAPER_OUT,     /**< Printer reported paper out */
+};
+
+/*!
+ * Error codes reported by lastError()
+ */
+enum thermalErrors {
+  THERMAL_OK,          /**< No error */
+  THERMAL_DTR_TIMEOUT, /**< Printer stayed busy past the DTR timeout */
+  THERMAL_PAPER_OUT,   /**< Paper ran out during printJob() */
+};
+
 /*!
  * Driver for the thermal printer
  */
@@ -108,12 +160,26 @@ public:
      * @param c Character to write
      * @return Returns true if successful
      */
-    write(uint8_t c);
+    write(uint8_t c),
+    /*!
+     * @brief Writes a block of text to the thermal printer
+     * @param buffer Characters to write
+     * @param size Number of characters
+     * @return Number of characters written
+     */
+    write(const uint8_t *buffer, size_t size);
+  using Print::write; // (write(const char *) etc.)
   void
     /*!
      * @param version firmware version as integer, e.g. 268 = 2.68 firmware
      */
     begin(uint16_t version=268),
+    /*!
+     * @brief Enables baud rate probing in begin()
+     * @param setBaud Function that sets the serial port to a given baud
+     * rate, or NULL to disable probing
+     */
+    autoBaud(void (*setBaud)(unsigned long)),
     /*!
      * @brief Disables bold text
      */
@@ -138,6 +204,11 @@ public:
      * @brief Enables double-width text
      */
     doubleWidthOn(),
+    /*!
+     * @brief Enables status-driven startup in begin()
+     * @param enable True to poll printer status instead of a fixed wait
+     */
+    fastStartup(bool enable=true),
     /*!
      * @brief Feeds by the specified number of lines 
      * @param x How many lines to feed 
@@ -152,6 +223,11 @@ public:
      * @brief Flush data pending in the printer 
      */
     flush(),
+    /*!
+     * @brief Sends any feed held back by setFeedCoalescing().  Other
+     * output does this automatically.
+     */
+    flushFeed(),
     /*!
      * @brief Disables white/black reverse printing mode
      */
@@ -160,6 +236,11 @@ public:
      * @brief Enables white/black reverse printing mode
      */
     inverseOn(),
+    /*!
+     * @brief Clears the error reported by lastError(), and drops a
+     * printJob() held by paper out
+     */
+    clearError(),
     /*!
      * @brief Set the justification of text
      * @param value justification, must be JUSTIFY_LEFT, JUSTIFY_CENTER, JUSTIFY_RIGHT
@@ -173,12 +254,6 @@ public:
      * @brief Put the printer into an online state after previously put offline
      */
     online(),
-    /*!
-     * @brief Print a barcode
-     * @param text The specified text/number (the meaning varies based on the type of barcode) and type to write to the barcode
-     * @param type Value from the datasheet or class-level variables like UPC-A. Note the type value changes depending on the firmware version so use class-level values where possible
-     */
-    printBarcode(const char *text, uint8_t type),
     /*!
      * @brief Prints a bitmap
      * @param w Width of the image in pixels
@@ -199,19 +274,86 @@ public:
      * @param fromStream Stream to get bitmap data from
      */
     printBitmap(Stream *fromStream),
+    /*!
+     * @brief Prints a bitmap supplied a row at a time
+     * @param w Width of the image in pixels
+     * @param h Height of the image in pixels
+     * @param getRow Function returning each row's data
+     * @param ctx Passed through to getRow
+     */
+    printBitmap(int w, int h, thermalRowFunc getRow, void *ctx),
     /*!
      * @brief Sets text to normal mode
      */ 
     normal(),
+    /*!
+     * @brief Collects an outstanding status reply, if one has arrived
+     */
+    poll(),
+    /*!
+     * @brief Issues a status query without waiting for the reply
+     */
+    requestStatus(),
+    /*!
+     * @brief Retrieves print and feed speed, e.g. to save tuned values
+     * @param p Receives print speed
+     * @param f Receives feed speed
+     */
+    getTimes(unsigned long *p, unsigned long *f),
     /*!
      * @brief Reset the printer
      */
     reset(),
+    /*!
+     * @brief Enables automatic adjustment of print and feed times
+     * @param enable True to tune times from measured completion
+     */
+    setAutoTune(bool enable=true),
+    /*!
+     * @brief Enables automatic heat settings by content density.  Bitmap
+     * chunks are classed by their first row (rows are read only once),
+     * so a dark band starting within a chunk prints up to 7 rows on the
+     * light profile.
+     * @param enable True to switch heat profiles as content changes
+     */
+    setAutoHeat(bool enable=true),
+    /*!
+     * @brief Queues all output in a ring, to be sent by service()
+     * @param ring Ring to queue into, or NULL for direct output (as is
+     * a ring that isn't valid())
+     */
+    setRing(Adafruit_ThermalRing *ring),
+    /*!
+     * @brief Records output, waits and DTR changes in a trace
+     * @param trace Trace to record into, or NULL to stop recording
+     */
+    setTrace(Adafruit_ThermalTrace *trace),
+    /*!
+     * @brief Sets the serial speed used for output timing
+     * @param baud Baud rate the printer's serial port is running at
+     */
+    setBaudRate(unsigned long baud),
+    /*!
+     * @brief Sets the printer's input buffer size, used to pace bitmaps
+     * @param bytes Buffer size in bytes
+     */
+    setBufferSize(uint16_t bytes),
     /*!
      * @brief Sets the barcode height
      * @param val Desired height of the barcode
      */
     setBarcodeHeight(uint8_t val=50),
+    /*!
+     * @brief Sets the barcode module width
+     * @param val Width in dots, 2 to 6
+     */
+    setBarcodeWidth(uint8_t val=3),
+    /*!
+     * @brief Scales bitmaps up when printed
+     * @param scale BITMAP_NORMAL, BITMAP_DOUBLE_WIDTH,
+     * BITMAP_DOUBLE_HEIGHT or BITMAP_QUADRUPLE
+     */
+    setBitmapScale(uint8_t scale=BITMAP_NORMAL),
     /*!
      * @brief Sets the font
      * @param font Desired font, either A or B
@@ -236,6 +378,14 @@ public:
      * @brief Sets the default settings
      */
     setDefault(),
+    /*!
+     * @brief Enables feed coalescing: blank lines, feed(), feedRows() and
+     * blank rows at the top (and, for in-memory bitmaps, bottom) of
+     * bitmaps are held back and sent as one exact paper feed before the
+     * next output, or on flushFeed()
+     * @param enable True to coalesce feeds
+     */
+    setFeedCoalescing(bool enable=true),
     /*!
      * @brief Sets the line height
      * @param val Desired line height
@@ -257,6 +407,26 @@ public:
      * @param f feed speed
      */
     setTimes(unsigned long, unsigned long),
+    /*!
+     * @brief Sets a function to call when paper runs out or is replaced
+     * @param callback Function taking true if paper is now present
+     */
+    setPaperCallback(void (*callback)(bool hasPaper)),
+    /*!
+     * @brief Sets the maximum wait for DTR handshaking
+     * @param ms Timeout in milliseconds, 0 to wait forever
+     */
+    setDtrTimeout(unsigned long ms),
+    /*!
+     * @brief Sets a function to call while waiting on the printer
+     * @param idle Function to call instead of yield(), or NULL
+     */
+    setIdleFunc(void (*idle)(void)),
+    /*!
+     * @brief Sets a function reporting printer readiness, replacing DTR reads
+     * @param ready Function returning true when the printer can accept data
+     */
+    setReadyFunc(bool (*ready)(void)),
     /*!
      * @brief Sets print head heating configuration
      * @param dots max printing dots, 8 dots per increment
@@ -326,7 +496,9 @@ public:
      */
     upsideDownOn(),
     /*!
-     * @brief Wakes device that was in sleep mode
+     * @brief Wakes device that was in sleep mode.  Does nothing unless
+     * the printer might be asleep (sleep(), or sleepAfter()'s time up);
+     * returns without waiting for the printer to settle.
      */
     wake();
   bool
@@ -334,10 +506,118 @@ public:
      * @brief Whether or not the printer has paper
      * @return Returns true if there is still paper
      */
-    hasPaper();
+    hasPaper(),
+    /*!
+     * @brief Print a barcode
+     * @param text The specified text/number (the meaning varies based on the type of barcode) and type to write to the barcode
+     * @param type Value from the datasheet or class-level variables like UPC-A. Note the type value changes depending on the firmware version so use class-level values where possible
+     * @return Returns false if the text isn't valid for the barcode type
+     */
+    printBarcode(const char *text, uint8_t type),
+    /*!
+     * @brief Polls printer status until it replies or time runs out
+     * @param maxWait Maximum time to wait, in microseconds
+     * @return Returns true if the printer answered
+     */
+    waitForPrinter(unsigned long maxWait),
+    /*!
+     * @brief Prints a job, checking for paper between lines and bitmap
+     * chunks.  If the paper runs out, the rest of the job is dropped and
+     * the point up to which it certainly printed is kept; calling
+     * printJob() again with the same job once there's paper prints from
+     * there on, the style in effect there restored.
+     * @param job Function that prints the job
+     * @param ctx Passed through to job
+     * @return Returns false if the paper ran out (lastError() is then
+     * THERMAL_PAPER_OUT), or is still out when resuming
+     */
+    printJob(thermalJobFunc job, void *ctx=NULL),
+    /*!
+     * @brief Sends data queued in ring mode, as pacing allows
+     * @return Returns true if data remains queued
+     */
+    service();
+#if !defined(ARDUINO) && defined(__linux__)
+  bool
+    /*!
+     * @brief Prints a bitmap file by memory-mapping it (Linux hosts only)
+     * @param path File in the printBitmap(Stream *) format: width and
+     * height, 16-bit little-endian, then the rows
+     * @return Returns false if the file can't be read or is short (the
+     * complete rows in a short file are still printed)
+     */
+    printBitmapFile(const char *path);
+#endif
+  unsigned long
+    /*!
+     * @brief Detects the printer's baud rate using status queries
+     * @return Detected baud rate, or 0 if the printer never answered
+     */
+    probeBaudRate(),
+    /*!
+     * @brief Time from begin() until the printer was ready for data
+     * @return Time-to-first-dot of the last begin(), in microseconds
+     */
+    startupTime(),
+    /*!
+     * @brief Time of the last status update
+     * @return millis() value when paperStatus() was last updated
+     */
+    statusTime(),
+    /*!
+     * @brief Where a printJob() stopped by paper out will resume
+     * @return Bytes of text (print(), write() etc.) already printed
+     */
+    checkpointOffset(),
+    /*!
+     * @brief Where a printJob() stopped by paper out will resume
+     * @return Bitmap rows already printed, counted over all the job's
+     * bitmaps
+     */
+    checkpointRow(),
+    /*!
+     * @brief Dry run: estimates a job's duration without sending anything
+     * @param job Function that prints the job
+     * @param ctx Passed through to job
+     * @param bytes If not NULL, receives the number of bytes the job sends
+     * @return Microseconds from the job's first byte until an idle
+     *         printer would finish it
+     */
+    estimate(thermalJobFunc job, void *ctx=NULL,
+             unsigned long *bytes=NULL);
+  long
+    /*!
+     * @brief Time until the printer can accept data without waiting
+     * @return Microseconds to wait; zero or negative if ready now
+     */
+    waitTime();
+  uint8_t
+    /*!
+     * @brief Paper state from the last status reply
+     * @return PAPER_PRESENT, PAPER_OUT or PAPER_UNKNOWN
+     */
+    paperStatus(),
+    /*!
+     * @brief Most recent error
+     * @return THERMAL_OK or an error code from thermalErrors
+     */
+    lastError();
+  int
+    /*!
+     * @brief Raw byte from the last status reply
+     * @return Status byte, or -1 if none
+     */
+    statusByte();
 
 private:
-  Stream *stream;
+  friend class Adafruit_ThermalNV;     // Downloads and prints NV bit images
+  friend class Adafruit_ThermalGlyphs; // Downloads user-defined characters
+  friend class Adafruit_ThermalLayout; // Reads column and maxColumn
+  friend class Adafruit_ThermalPool;   // Steps jobs without waiting
+  Stream *stream, // Output (the ring, in ring mode)
+      *port;      // Serial port, in ring mode
+  Adafruit_ThermalRing *ring; // Output ring, or NULL for direct output
+  Adafruit_ThermalTrace *trace; // Event trace, or NULL if not recording
   uint8_t printMode,
       prevByte,      // Last character issued to printer
       column,        // Last horizontal column printed
@@ -345,19 +625,93 @@ private:
       charHeight,    // Height of characters, in 'dots'
       lineSpacing,   // Inter-line spacing (not line height), in dots
       barcodeHeight, // Barcode height in dots, not including text
+      barcodeWidth,  // Barcode module width in dots
+      barcodeSent,   // Module width last sent to printer, 0 if none
+      bitmapScale,   // Bitmap scaling, from bitmapScales
+      heatClass,     // Heat profile the printer is on (setAutoHeat())
+      align,         // Justification, as sent with ESC a
+      underline,     // Underline weight
+      rasterMode,    // INVERSE_MASK/UPDOWN_MASK set by GS B/ESC { (2.68+)
+      jobState,      // JOB_NONE, or printJob()'s progress (JOB_RUN etc.)
       maxChunkHeight,
-      dtrPin;         // DTR handshaking pin (experimental)
-  uint16_t firmware;  // Firmware version
-  boolean dtrEnabled; // True if DTR pin set & printer initialized
+      dtrPin,        // DTR handshaking pin (experimental)
+      lastStatus,    // Last status byte received from printer
+      paperState,    // PAPER_PRESENT, PAPER_OUT or PAPER_UNKNOWN
+      errorCode,     // Most recent error, from thermalErrors
+      tuneKind;      // TUNE_PRINT/TUNE_FEED if awaiting a tuning reply, or 0
+  uint16_t firmware,  // Firmware version
+      bufferSize,     // Printer input buffer size, in bytes
+      tuneRows,       // Rows covered by the pending tuning sample
+      ringRows,       // Buffer rows for bitmap row queued in ring
+      pendingFeed,    // Dots of feed held back by setFeedCoalescing()
+      sleepSeconds,   // Last sleepAfter() time, 0 if sleep is off
+      lines,          // Count of lines ended (wraps)
+      resets;         // Count of reset() calls (wraps)
+  boolean dtrEnabled, // True if DTR pin set & printer initialized
+      statusBoot,     // True if begin() should poll status (fastStartup())
+      statusPending,  // True if a status query awaits its reply
+      autoTune,       // True if print/feed times adapt (setAutoTune())
+      autoHeat,       // True if heat settings follow content (setAutoHeat())
+      rowActive,      // True if service() is sending bitmap rows
+      rowQueued,      // True if service()'s next data run is a bitmap row
+      feedCoalesce,   // True if feeds are held back (setFeedCoalescing())
+      estimating,     // True while estimate() runs a job
+      sleepKnown,     // True once sleepSeconds reflects the printer's timer
+      wakePending,    // True if wake() has more to send (finishWake())
+      settling,       // True if a settle() wait may be due (with DTR)
+      jobQuery,       // True if the pending status query is a job check
+      jobHeld,        // True if a printJob() awaits resuming
+      lineHeld,       // True if paper out came with part of a line sent
+      bandMore,       // True if printBand() has more rows to follow
+      bandCont;       // True if printBand() continues an earlier band
   unsigned long
+      byteTime,     // Time to issue one byte at current baud, in microseconds
       resumeTime,   // Wait until micros() exceeds this before sending byte
+      settleTime,   // Same, but applies with DTR too (see settle())
       dotPrintTime, // Time to print a single dot line, in microseconds
-      dotFeedTime;  // Time to feed a single dot line, in microseconds
+      dotFeedTime,  // Time to feed a single dot line, in microseconds
+      startupMicros, // Time-to-first-dot measured by begin()
+      statusQueryTime,  // millis() when outstanding status query was sent
+      statusUpdateTime, // millis() when paperState was last updated
+      dtrTimeout,       // Max wait for DTR ready, in milliseconds
+      tuneEnd,          // Predicted reply time for tuning sample, micros()
+      lastCollect,      // micros() of last check for a status reply
+      headTime,         // When head will finish bitmap rows sent so far
+      ringRowTime,      // Print time for bitmap row queued in ring
+      estimateClock,    // now() while estimating
+      lastActivity,     // millis() when a byte was last sent
+      jobBytes,         // Text bytes so far in printJob()
+      jobRows,          // Bitmap rows so far in printJob()
+      queryBytes,       // jobBytes when the job check was sent
+      queryRows,        // jobRows when the job check was sent
+      resumeBytes,      // jobBytes up to which the held job has printed
+      resumeRows;       // jobRows up to which the held job has printed
+  struct {
+    uint8_t printMode, lineSpacing, align, underline, rasterMode,
+        barcodeHeight, column;
+  } jobStyle; // Style when printJob() began
+  void (*baudSetter)(unsigned long); // Sets host port speed for autoBaud()
+  void (*paperCallback)(bool);       // Called on paper state transitions
+  bool (*readyFunc)(void);           // Replaces DTR pin read if set
+  void (*idleFunc)(void);            // Replaces yield() while waiting if set
   void writeBytes(uint8_t a), writeBytes(uint8_t a, uint8_t b),
       writeBytes(uint8_t a, uint8_t b, uint8_t c),
       writeBytes(uint8_t a, uint8_t b, uint8_t c, uint8_t d),
       setPrintMode(uint8_t mask), unsetPrintMode(uint8_t mask),
-      writePrintMode(), adjustCharValues(uint8_t printMode);
+      writePrintMode(), adjustCharValues(uint8_t printMode),
+      writeStatusQuery(), collectStatus(), idle(), finishWake(),
+      startTune(uint8_t kind, uint16_t rows, unsigned long end),
+      tuneTimes(unsigned long replyTime),
+      rowWait(uint16_t bufferRows, unsigned long rowTime),
+      rowSent(uint8_t n, unsigned long rowTime), writeFeed(uint8_t rows),
+      setHeatClass(uint8_t c), checkPaper(bool force), resumeJob(),
+      pauseJob(), holdFeed(unsigned long dots), settle(unsigned long x);
+  bool printerReady(), mightSleep(), skipOutput(),
+      writeOutput(const uint8_t *cmd, uint8_t n);
+  uint8_t textHeat();
+  int printBand(int w, int h, const uint8_t *bitmap, bool fromProgMem,
+                uint16_t maxBytes, bool cont);
+  unsigned long now();
 };
 
 #endif // ADAFRUIT_THERMAL_H
@@ -0,0 +1,97 @@
+/*!
+ * @file Adafruit_ThermalGlyphs.cpp
+ *
+ * User-defined characters: ESC & y c1 c2 [x d1...d(y*x)] defines codes
+ * c1-c2, each x dots wide and y bytes (8y dots) tall, as column-major
+ * data with the top dot of each byte in its MSB; ESC % 1 selects the
+ * user-defined set.  Codes that were never defined still print as usual.
+ * Printers render a line's characters when it prints, so redefining a
+ * code already on the current line would change that too; such slots are
+ * pinned until the printer's line count moves on.
+ */
+
+#include "Adafruit_ThermalGlyphs.h"
+
+#define ASCII_ESC 27 //!< Escape
+
+#define GLYPH_BYTES (GLYPH_WIDTH * GLYPH_HEIGHT / 8) //!< Data per glyph
+#define GLYPH_ROW_BYTES ((GLYPH_WIDTH + 7) / 8)      //!< Source bytes per row
+
+Adafruit_ThermalGlyphs::Adafruit_ThermalGlyphs(Adafruit_Thermal *p,
+                                               uint8_t firstCode,
+                                               uint8_t numCodes)
+    : printer(p), first(firstCode), count(numCodes) {
+  if (count > GLYPH_MAX_SLOTS)
+    count = GLYPH_MAX_SLOTS;
+  if (first + count > 127)
+    count = (first < 127) ? 127 - first : 0;
+  clear();
+}
+
+void Adafruit_ThermalGlyphs::clear() {
+  for (uint8_t i = 0; i < GLYPH_MAX_SLOTS; i++)
+    slots[i].glyph = NULL;
+  clock = 0;
+  enabled = false;
+  resets = printer->resets;
+}
+
+bool Adafruit_ThermalGlyphs::print(const uint8_t *glyph, bool fromProgMem) {
+  uint8_t i, slot = count, buf[GLYPH_BYTES], *b = buf;
+  uint16_t age, oldest = 0;
+
+  if (resets != printer->resets) // Printer has forgotten them
+    clear();
+
+  for (i = 0; i < count; i++) {
+    if (slots[i].glyph == glyph) {
+      slot = i;
+      break;
+    }
+  }
+
+  if (slot == count) { // Not cached; pick an empty or least recent slot
+    for (i = 0; i < count; i++) {
+      if (!slots[i].glyph) {
+        slot = i;
+        break;
+      }
+      if (slots[i].line == printer->lines)
+        continue; // Pinned
+      age = clock - slots[i].used;
+      if ((slot == count) || (age > oldest)) {
+        slot = i;
+        oldest = age;
+      }
+    }
+    if (slot == count)
+      return false;
+
+    if (!enabled) {
+      printer->writeBytes(ASCII_ESC, '%', 1);
+      enabled = true;
+    }
+    printer->writeBytes(ASCII_ESC, '&', GLYPH_HEIGHT / 8, first + slot);
+    printer->writeBytes(first + slot, GLYPH_WIDTH);
+    for (uint8_t x = 0; x < GLYPH_WIDTH; x++) { // Transpose to columns
+      uint8_t mask = 0x80 >> (x & 7);
+      for (uint8_t y = 0; y < GLYPH_HEIGHT; y += 8, b++) {
+        *b = 0;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+          const uint8_t *p = glyph + (y + bit) * GLYPH_ROW_BYTES + x / 8;
+          if ((fromProgMem ? pgm_read_byte(p) : *p) & mask)
+            *b |= 0x80 >> bit;
+        }
+      }
+    }
+    printer->timeoutWait();
+    printer->stream->write(buf, GLYPH_BYTES);
+    printer->timeoutSet(GLYPH_BYTES * printer->byteTime);
+    slots[slot].glyph = glyph;
+  }
+
+  printer->write(first + slot);
+  slots[slot].line = printer->lines; // (After write(), in case it wrapped)
+  slots[slot].used = clock++;
+  return true;
+}
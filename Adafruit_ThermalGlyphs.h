@@ -0,0 +1,67 @@
+/*!
+ * @file Adafruit_ThermalGlyphs.h
+ */
+
+#ifndef ADAFRUIT_THERMALGLYPHS_H
+#define ADAFRUIT_THERMALGLYPHS_H
+
+#include "Adafruit_Thermal.h"
+
+#define GLYPH_MAX_SLOTS 8 //!< Character codes one cache can manage
+#define GLYPH_WIDTH 12    //!< Glyph width in dots (font A)
+#define GLYPH_HEIGHT 24   //!< Glyph height in dots (font A)
+
+/*!
+ * Cache of small icons (checkmarks, arrows, currency symbols...) held in
+ * the printer as user-defined characters.  Each glyph is downloaded into
+ * one of a range of character codes set aside for the purpose, then
+ * printed inline with the surrounding text as that single byte.  When all
+ * codes are taken, the least recently used glyph is replaced, except that
+ * glyphs already on the current line are kept until the line prints.
+ * Glyphs are drawn in font A; reset() clears them from the printer and
+ * the cache notices.
+ */
+class Adafruit_ThermalGlyphs {
+
+public:
+  /*!
+   * @brief Glyph cache constructor
+   * @param printer Printer to print on
+   * @param firstCode First character code to use (32-126)
+   * @param numCodes Number of consecutive codes, up to GLYPH_MAX_SLOTS.
+   * These print as glyphs from then on, not as their usual characters.
+   */
+  Adafruit_ThermalGlyphs(Adafruit_Thermal *printer, uint8_t firstCode,
+                         uint8_t numCodes);
+
+  bool
+    /*!
+     * @brief Prints a glyph at the current position, downloading it first
+     * if the printer doesn't have it
+     * @param glyph GLYPH_WIDTH x GLYPH_HEIGHT bitmap (2 bytes per row), in
+     * the same format as printBitmap(); identified by its address
+     * @param fromProgMem True if the glyph is in PROGMEM
+     * @return Returns false if every code is in use on the current line
+     */
+    print(const uint8_t *glyph, bool fromProgMem=true);
+  void
+    /*!
+     * @brief Forgets all downloaded glyphs (e.g. after a printer power
+     * cycle)
+     */
+    clear();
+
+private:
+  struct Slot {
+    const uint8_t *glyph; // Glyph held by this code, or NULL
+    uint16_t line,        // Printer line count when last printed
+        used;             // LRU clock when last printed
+  } slots[GLYPH_MAX_SLOTS];
+  Adafruit_Thermal *printer;
+  uint8_t first, count,
+      resets; // Printer's reset count as of the last download
+  uint16_t clock;
+  bool enabled; // True if ESC % 1 sent since the last reset
+};
+
+#endif // ADAFRUIT_THERMALGLYPHS_H
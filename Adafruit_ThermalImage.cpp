@@ -0,0 +1,214 @@
+/*!
+ * @file Adafruit_ThermalImage.cpp
+ *
+ * Header parsing follows the formats' own specs loosely: BMP files may
+ * have the old 12-byte core header or any of the 40+ byte info headers,
+ * and the two-entry palette decides which bit value prints black (the
+ * printer's 1 is black, so a palette with black first is inverted).
+ * Bits past the image width in each row's last byte, and the padding
+ * BMP rows carry to a 4-byte boundary, are dropped.  PBM headers may
+ * carry # comments.
+ */
+
+#include "Adafruit_ThermalImage.h"
+
+Adafruit_ThermalImage::Adafruit_ThermalImage(Stream *s, thermalSeekFunc f)
+    : stream(s), seek(f), type(IMAGE_NONE), w(0), h(0) {}
+
+// Next byte from the stream, waiting up to IMAGE_TIMEOUT for it; -1 (from
+// then on) if none comes.
+int Adafruit_ThermalImage::next() {
+  unsigned long start;
+  int c;
+
+  if (ended)
+    return -1;
+  if ((c = stream->read()) >= 0)
+    return c;
+  start = millis();
+  while ((c = stream->read()) < 0) {
+    if ((millis() - start) >= IMAGE_TIMEOUT) {
+      ended = true;
+      return -1;
+    }
+    yield();
+  }
+  return c;
+}
+
+unsigned long Adafruit_ThermalImage::readLE(uint8_t n) {
+  unsigned long v = 0;
+  for (uint8_t i = 0; i < n; i++)
+    v |= (unsigned long)(next() & 0xFF) << (8 * i);
+  return v;
+}
+
+bool Adafruit_ThermalImage::skip(unsigned long n) {
+  while (n--) {
+    if (next() < 0)
+      return false;
+  }
+  return true;
+}
+
+bool Adafruit_ThermalImage::begin() {
+  int a, b;
+  bool ok = false;
+
+  type = IMAGE_NONE;
+  ended = false;
+  a = next();
+  b = next();
+  if ((a == 'B') && (b == 'M'))
+    ok = readBMP();
+  else if ((a == 'P') && (b == '4'))
+    ok = readPBM();
+  if (!ok || ended || (w <= 0) || (h <= 0))
+    return false;
+
+  int bytes = (w + 7) / 8;
+  rowBytes = (bytes < THERMAL_MAX_ROW_BYTES) ? bytes : THERMAL_MAX_ROW_BYTES;
+  lastMask = ((bytes == rowBytes) && (w & 7)) ? 0xFF << (8 - (w & 7)) : 0xFF;
+  groupRows = (IMAGE_GROUP_BYTES / rowBytes < 255)
+                  ? IMAGE_GROUP_BYTES / rowBytes
+                  : 255;
+  groupStart = groupCount = 0;
+  type = (a == 'B') ? IMAGE_BMP : IMAGE_PBM;
+  return true;
+}
+
+bool Adafruit_ThermalImage::readBMP() {
+  unsigned long header, pos, compression = 0;
+  long height;
+  uint16_t bits;
+  uint8_t entry, lum[2];
+
+  readLE(4); // File size
+  readLE(4); // Reserved
+  dataOffset = readLE(4);
+  header = readLE(4);
+  if (header == 12) { // BITMAPCOREHEADER
+    w = (int16_t)readLE(2);
+    height = (int16_t)readLE(2);
+    readLE(2); // Planes
+    bits = readLE(2);
+    entry = 3;
+  } else if (header >= 40) { // BITMAPINFOHEADER or later
+    long width = (int32_t)readLE(4);
+    height = (int32_t)readLE(4);
+    readLE(2); // Planes
+    bits = readLE(2);
+    compression = readLE(4);
+    if (!skip(header - 20))
+      return false;
+    if ((width <= 0) || (width > 0x7FFF))
+      return false;
+    w = width;
+    entry = 4;
+  } else {
+    return false;
+  }
+  if ((bits != 1) || compression || !height || (height < -0x7FFF) ||
+      (height > 0x7FFF))
+    return false;
+  bottomUp = (height > 0);
+  h = bottomUp ? height : -height;
+
+  // Palette: compare the entries' brightness (blue, green, red order)
+  for (uint8_t i = 0; i < 2; i++) {
+    uint8_t b = next(), g = next(), r = next();
+    lum[i] = (b + 5 * g + 2 * r) >> 3;
+    if (entry == 4)
+      next();
+  }
+  invert = (lum[0] < lum[1]);
+
+  pos = 14 + header + 2 * entry;
+  stride = (((unsigned long)w + 31) / 32) * 4;
+  if (dataOffset < pos)
+    return false;
+  if (bottomUp)
+    return (seek != NULL); // getRow() seeks to each group of rows
+  return skip(dataOffset - pos);
+}
+
+// Reads a decimal number from a PBM header, skipping whitespace and
+// comments before it; the single whitespace character after it is
+// consumed too.  Returns -1 if there isn't one.
+long Adafruit_ThermalImage::readNumber() {
+  long n = 0;
+  int c;
+
+  while (((c = next()) == '#') || isspace(c)) {
+    if (c == '#') {
+      while (((c = next()) >= 0) && (c != '\n'))
+        ;
+    }
+  }
+  if (!isdigit(c))
+    return -1;
+  for (; isdigit(c) && (n <= 0x7FFF); c = next())
+    n = n * 10 + (c - '0');
+  return n;
+}
+
+bool Adafruit_ThermalImage::readPBM() {
+  long width = readNumber(), height = readNumber();
+
+  if ((width <= 0) || (width > 0x7FFF) || (height <= 0) ||
+      (height > 0x7FFF))
+    return false;
+  w = width;
+  h = height;
+  stride = (w + 7) / 8;
+  invert = bottomUp = false;
+  return true;
+}
+
+// Reads the next row in the file into buf, keeping what fits on the
+// printer.  Anything past the end of the stream reads as white.
+void Adafruit_ThermalImage::readRow(uint8_t *buf) {
+  for (unsigned long x = 0; x < stride; x++) {
+    int c = next();
+    if (x < rowBytes)
+      buf[x] = (c < 0) ? 0 : invert ? ~c : c;
+  }
+  buf[rowBytes - 1] &= lastMask;
+}
+
+// Row source for printBitmap().  Bottom-up files are read a group of rows
+// at a time: one seek to the lowest row in the file (the bottom of the
+// group on paper), then the group straight through, stored in reverse.
+const uint8_t *Adafruit_ThermalImage::getRow(void *ctx, int y, uint8_t *buf) {
+  Adafruit_ThermalImage *img = (Adafruit_ThermalImage *)ctx;
+  uint8_t n;
+
+  if (!img->bottomUp) {
+    img->readRow(buf);
+    return buf;
+  }
+  if ((y < img->groupStart) || (y >= img->groupStart + img->groupCount)) {
+    n = (img->h - y < img->groupRows) ? img->h - y : img->groupRows;
+    unsigned long first = img->h - y - n; // Lowest row in the file
+    if (!img->ended && !img->seek(img->dataOffset + first * img->stride))
+      img->ended = true; // Rows read as white from here on
+    for (uint8_t k = n; k--;)
+      img->readRow(img->group + k * img->rowBytes);
+    img->groupStart = y;
+    img->groupCount = n;
+  }
+  return img->group + (y - img->groupStart) * img->rowBytes;
+}
+
+bool Adafruit_ThermalImage::print(Adafruit_Thermal *printer) {
+  if (!type && !begin())
+    return false;
+  printer->printBitmap(w, h, getRow, this);
+  return true;
+}
+
+uint8_t Adafruit_ThermalImage::format() { return type; }
+
+int Adafruit_ThermalImage::width() { return w; }
+
+int Adafruit_ThermalImage::height() { return h; }
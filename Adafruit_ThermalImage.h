@@ -0,0 +1,106 @@
+/*!
+ * @file Adafruit_ThermalImage.h
+ */
+
+#ifndef ADAFRUIT_THERMALIMAGE_H
+#define ADAFRUIT_THERMALIMAGE_H
+
+#include "Adafruit_Thermal.h"
+
+// Bytes of rows held per seek when reading a bottom-up BMP; a 384-pixel
+// wide image gets 5 rows at a time.
+#ifndef IMAGE_GROUP_BYTES
+#define IMAGE_GROUP_BYTES 240 //!< Row buffer for bottom-up BMP files
+#endif
+#ifndef IMAGE_TIMEOUT
+#define IMAGE_TIMEOUT 1000 //!< Max wait for a byte, milliseconds
+#endif
+
+#define IMAGE_NONE 0 //!< No image read (or not a supported format)
+#define IMAGE_BMP 1  //!< Windows BMP, 1 bit per pixel, uncompressed
+#define IMAGE_PBM 2  //!< Netpbm binary bitmap (P4)
+
+/*!
+ * Moves a Stream's read position to the given byte offset from the start
+ * of the image (e.g. return file.seek(position) for an SD card File).
+ * Returns false if it can't.
+ */
+typedef bool (*thermalSeekFunc)(unsigned long position);
+
+/*!
+ * Streaming decoder for 1-bit image files, as saved by most image editors,
+ * printed through Adafruit_Thermal::printBitmap() a row at a time so the
+ * image is never held in memory.  Reads uncompressed 1 bit per pixel BMP
+ * files (with either palette order) and binary PBM (P4) files.  BMP rows
+ * are usually stored bottom row first; those files can only be printed
+ * if a seek function is supplied, in which case rows are read in groups
+ * of up to IMAGE_GROUP_BYTES, one seek per group.  Top-down BMP and PBM
+ * files are read straight through.  Images wider than the printer are
+ * clipped at the right; a file that ends early (no byte for
+ * IMAGE_TIMEOUT) prints blank for the rest of the image.
+ */
+class Adafruit_ThermalImage {
+
+public:
+  /*!
+   * @brief Image decoder constructor
+   * @param s Stream positioned at the start of the file
+   * @param seek Function to reposition s, or NULL if it can't be
+   */
+  Adafruit_ThermalImage(Stream *s, thermalSeekFunc seek=NULL);
+
+  bool
+    /*!
+     * @brief Reads the file header.  print() calls this if needed.
+     * @return Returns false if the file isn't a supported format, or is
+     * a bottom-up BMP and there's no seek function
+     */
+    begin(),
+    /*!
+     * @brief Prints the image
+     * @param printer Printer to print on
+     * @return Returns false (printing nothing) if begin() fails
+     */
+    print(Adafruit_Thermal *printer);
+  uint8_t
+    /*!
+     * @brief Format of the file, once begin() has read it
+     * @return IMAGE_BMP, IMAGE_PBM or IMAGE_NONE
+     */
+    format();
+  int
+    /*!
+     * @brief Image width, once begin() has read it
+     * @return Width in pixels
+     */
+    width(),
+    /*!
+     * @brief Image height, once begin() has read it
+     * @return Height in pixels
+     */
+    height();
+
+private:
+  Stream *stream;
+  thermalSeekFunc seek;
+  uint8_t type,
+      rowBytes,   // Bytes of each row kept (clipped to the printer width)
+      lastMask,   // Keeps the image's pixels in the last byte kept
+      groupRows,  // Rows per group (bottom-up BMP)
+      groupCount; // Rows in the group loaded
+  bool invert,    // True if palette entry 0 is the darker (BMP)
+      bottomUp,   // True if rows are stored bottom row first (BMP)
+      ended;      // True once the stream has run dry
+  int w, h, groupStart;
+  unsigned long stride, // Bytes per row in the file, padding included
+      dataOffset;       // Offset of the first row in the file (BMP)
+  uint8_t group[IMAGE_GROUP_BYTES];
+  int next();
+  unsigned long readLE(uint8_t n);
+  long readNumber();
+  bool readBMP(), readPBM(), skip(unsigned long n);
+  void readRow(uint8_t *buf);
+  static const uint8_t *getRow(void *ctx, int y, uint8_t *buf);
+};
+
+#endif // ADAFRUIT_THERMALIMAGE_H
@@ -0,0 +1,163 @@
+/*!
+ * @file Adafruit_ThermalLayout.cpp
+ *
+ * Single-pass line layout.  Characters collect in a buffer one line long;
+ * when a character would overflow it, the line is sent up to the last
+ * space and the unfinished word moves to the start of the next.  Cells
+ * and leaders just pad the same buffer, so memory use is fixed at one
+ * line whatever the source.
+ */
+
+#include "Adafruit_ThermalLayout.h"
+
+Adafruit_ThermalLayout::Adafruit_ThermalLayout(Adafruit_Thermal *p)
+    : printer(p), len(0), width(LAYOUT_MAX_LINE), cellWidth(0),
+      lastSpace(-1), wrapped(false) {}
+
+// Room left on the printer's current line, for the current font and size.
+uint8_t Adafruit_ThermalLayout::lineWidth() {
+  uint8_t w = printer->maxColumn;
+  if (printer->column < w)
+    w -= printer->column;
+  return (w > LAYOUT_MAX_LINE) ? LAYOUT_MAX_LINE : w;
+}
+
+// Sends the first n characters as a line (less trailing spaces) and keeps
+// the rest, less leading spaces, as the start of the next.
+void Adafruit_ThermalLayout::emit(uint8_t n) {
+  uint8_t i, end = n;
+
+  while (end && (line[end - 1] == ' '))
+    end--;
+  for (i = 0; i < end; i++)
+    printer->write(line[i]);
+  printer->write('\n');
+
+  while ((n < len) && (line[n] == ' '))
+    n++;
+  len -= n;
+  memmove(line, line + n, len);
+  lastSpace = -1;
+  for (i = 0; i < len; i++) {
+    if (line[i] == ' ')
+      lastSpace = i;
+  }
+  width = lineWidth();
+}
+
+size_t Adafruit_ThermalLayout::write(uint8_t c) {
+  if (c == '\r')
+    return 1;
+  if (!len)
+    width = lineWidth();
+
+  if (cellWidth) { // Cells don't wrap; excess text is dropped
+    if (c != '\n') {
+      if (len < cellStart + cellWidth)
+        line[len++] = c;
+      return 1;
+    }
+    endCell(); // Newline ends the cell, then the line
+  }
+
+  if (c == '\n') {
+    emit(len);
+    wrapped = false;
+  } else if (c == ' ') {
+    if (!len && wrapped)
+      return 1; // No leading spaces on wrapped lines
+    if (len >= width) {
+      emit(len); // Space falls at the margin
+      wrapped = true;
+    } else {
+      lastSpace = len;
+      line[len++] = ' ';
+    }
+  } else {
+    if (len >= width) {
+      // Break after the last word, or mid-word if it fills the line.
+      emit((lastSpace > 0) ? lastSpace : len);
+      wrapped = true;
+    }
+    line[len++] = c;
+  }
+  return 1;
+}
+
+size_t Adafruit_ThermalLayout::printStream(Stream *fromStream) {
+  size_t n = 0;
+  int c;
+
+  while ((c = fromStream->read()) >= 0) {
+    write(c);
+    n++;
+  }
+  return n;
+}
+
+void Adafruit_ThermalLayout::cell(uint8_t w, char align) {
+  if (cellWidth)
+    endCell();
+  if (!len)
+    width = lineWidth();
+  if (len >= width) // No room left on this line
+    emit(len);
+  cellStart = len;
+  cellWidth = (w && (w < width - len)) ? w : width - len;
+  cellAlign = align;
+}
+
+void Adafruit_ThermalLayout::endCell() {
+  uint8_t n, pad, shift;
+
+  if (!cellWidth)
+    return;
+  n = len - cellStart;
+  pad = cellWidth - n;
+  shift = (cellAlign == 'R') ? pad : (cellAlign == 'C') ? pad / 2 : 0;
+  memmove(line + cellStart + shift, line + cellStart, n);
+  memset(line + cellStart, ' ', shift);
+  memset(line + cellStart + shift + n, ' ', pad - shift);
+  len = cellStart + cellWidth;
+  cellWidth = 0;
+  lastSpace = -1; // Don't wrap inside a cell
+}
+
+void Adafruit_ThermalLayout::leader(const char *right, char fill) {
+  leader(right, false, fill);
+}
+
+void Adafruit_ThermalLayout::leader(const __FlashStringHelper *right,
+                                    char fill) {
+  leader((const char *)right, true, fill);
+}
+
+void Adafruit_ThermalLayout::leader(const char *right, bool fromProgMem,
+                                    char fill) {
+  uint8_t n;
+  size_t rlen;
+
+  if (cellWidth)
+    endCell();
+  if (!len)
+    width = lineWidth();
+  rlen = fromProgMem ? strlen_P(right) : strlen(right);
+  if (rlen > width)
+    rlen = width;
+  if (len && (len + rlen >= width)) // No room for fill; leader on next line
+    emit(len);
+  while (len < width - rlen)
+    line[len++] = fill;
+  for (n = 0; n < rlen; n++)
+    line[len++] = fromProgMem ? pgm_read_byte(right + n) : right[n];
+  emit(len);
+  wrapped = false;
+}
+
+void Adafruit_ThermalLayout::flush() {
+  if (cellWidth)
+    endCell();
+  if (len)
+    emit(len);
+  wrapped = false;
+}
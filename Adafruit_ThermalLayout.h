@@ -0,0 +1,88 @@
+/*!
+ * @file Adafruit_ThermalLayout.h
+ */
+
+#ifndef ADAFRUIT_THERMALLAYOUT_H
+#define ADAFRUIT_THERMALLAYOUT_H
+
+#include "Adafruit_Thermal.h"
+
+#define LAYOUT_MAX_LINE 48 //!< Longest line buffered, in characters
+
+/*!
+ * Text layout for the printer's current font and size: word wrapping,
+ * fixed-width aligned columns and dot leaders (e.g. for price lines).
+ * Text printed to a layout (it's a Print, so anything print() accepts,
+ * including F() strings, or printStream() from a Stream) is held one line
+ * at a time and sent to the printer already broken into lines, so the
+ * printer never wraps mid-word and its timing estimates stay exact.
+ * Call flush() before changing the font or size.
+ */
+class Adafruit_ThermalLayout : public Print {
+
+public:
+  /*!
+   * @brief Layout constructor
+   * @param printer Printer to print on
+   */
+  Adafruit_ThermalLayout(Adafruit_Thermal *printer);
+
+  size_t
+    /*!
+     * @brief Adds a character to the current line (or cell)
+     * @param c Character to add
+     * @return 1
+     */
+    write(uint8_t c),
+    /*!
+     * @brief Copies text from a Stream until it has no more
+     * @param fromStream Stream to read
+     * @return Number of characters copied
+     */
+    printStream(Stream *fromStream);
+  using Print::write;
+  void
+    /*!
+     * @brief Starts a fixed-width cell; text printed until endCell() is
+     * aligned within it and cut off if too long
+     * @param width Width in characters, or 0 for the rest of the line
+     * @param align 'L', 'C' or 'R'
+     */
+    cell(uint8_t width, char align='L'),
+    /*!
+     * @brief Ends the current cell, padding it to its full width
+     */
+    endCell(),
+    /*!
+     * @brief Fills the rest of the line and ends it with right-aligned text
+     * @param right Text to print at the right margin (e.g. a price)
+     * @param fill Fill character
+     */
+    leader(const char *right, char fill='.'),
+    /*!
+     * @brief Fills the rest of the line and ends it with right-aligned text
+     * @param right Text in PROGMEM (e.g. F("...")) for the right margin
+     * @param fill Fill character
+     */
+    leader(const __FlashStringHelper *right, char fill='.'),
+    /*!
+     * @brief Prints any partial line, ending it
+     */
+    flush();
+
+private:
+  Adafruit_Thermal *printer;
+  char line[LAYOUT_MAX_LINE];
+  uint8_t len,     // Characters in line
+      width,       // Line width, fixed when the line is started
+      cellStart,   // Start of current cell in line
+      cellWidth;   // Width of current cell, 0 if not in a cell
+  int8_t lastSpace; // Index of last space in line, -1 if none
+  char cellAlign;
+  bool wrapped;     // True if line continues a wrapped paragraph
+  uint8_t lineWidth();
+  void emit(uint8_t n), leader(const char *right, bool fromProgMem,
+                               char fill);
+};
+
+#endif // ADAFRUIT_THERMALLAYOUT_H
@@ -0,0 +1,124 @@
+/*!
+ * @file Adafruit_ThermalNV.cpp
+ *
+ * Non-volatile bit image storage: FS q n [xL xH yL yH d1...dk]1..n
+ * replaces every stored image at once, and FS p n m prints image n.
+ * Image dimensions are in units of 8 dots, and the data is column-major
+ * with the top pixel of each vertical byte in its MSB, so the library's
+ * row-major bitmaps are transposed on the fly as they're sent.
+ */
+
+#include "Adafruit_ThermalNV.h"
+
+#define ASCII_FS 28 //!< Field separator
+
+#define FNV_OFFSET 2166136261UL //!< FNV-1a initial hash
+#define FNV_PRIME 16777619UL    //!< FNV-1a multiplier
+#define NV_CHUNK 32             //!< Image bytes sent per write
+// Time for the printer to commit a downloaded image set to its flash,
+// in microseconds.  Generous, as the printer can't be queried meanwhile.
+#define NV_WRITE_TIME 1000000L
+
+static uint32_t fnv(uint32_t h, uint8_t c) { return (h ^ c) * FNV_PRIME; }
+
+Adafruit_ThermalNV::Adafruit_ThermalNV(Adafruit_Thermal *p)
+    : printer(p), stored(0) {
+  clear();
+}
+
+void Adafruit_ThermalNV::clear() {
+  count = 0;
+  setHash = FNV_OFFSET;
+}
+
+// The set's hash covers every image's size and data, in order, so it
+// changes whenever anything FS q would send changes.
+int8_t Adafruit_ThermalNV::add(int w, int h, const uint8_t *bitmap,
+                               bool fromProgMem) {
+  if ((count >= NV_MAX_IMAGES) || (w < 1) || (w > 384) || (h < 1) ||
+      (h > 2304))
+    return -1;
+  Image *img = &images[count];
+  img->data = bitmap;
+  img->w = w;
+  img->h = h;
+  img->fromProgMem = fromProgMem;
+
+  setHash = fnv(setHash, w);
+  setHash = fnv(setHash, w >> 8);
+  setHash = fnv(setHash, h);
+  setHash = fnv(setHash, h >> 8);
+  for (unsigned long i = 0, n = (unsigned long)((w + 7) / 8) * h; i < n; i++)
+    setHash = fnv(setHash, fromProgMem ? pgm_read_byte(bitmap + i)
+                                       : bitmap[i]);
+  if (!setHash) // 0 is reserved for 'unknown'
+    setHash = 1;
+  return count++;
+}
+
+bool Adafruit_ThermalNV::sync() {
+  uint8_t buf[NV_CHUNK], n = 0, i, bit;
+  uint16_t x, y, col, j;
+
+  if (!count || (setHash == stored))
+    return false;
+
+  printer->writeBytes(ASCII_FS, 'q', count);
+  for (i = 0; i < count; i++) {
+    const Image *img = &images[i];
+    x = (img->w + 7) / 8; // Also the bitmap's bytes per row
+    y = (img->h + 7) / 8;
+    printer->writeBytes(x, x >> 8, y, y >> 8);
+    for (col = 0; col < x * 8; col++) {
+      uint8_t mask = 0x80 >> (col & 7);
+      for (j = 0; j < y; j++) {
+        uint8_t c = 0;
+        for (bit = 0; (bit < 8) && (j * 8 + bit < img->h); bit++) {
+          const uint8_t *p = img->data + (j * 8UL + bit) * x + col / 8;
+          if ((img->fromProgMem ? pgm_read_byte(p) : *p) & mask)
+            c |= 0x80 >> bit;
+        }
+        buf[n++] = c;
+        if (n == NV_CHUNK) {
+          printer->timeoutWait();
+          printer->stream->write(buf, n);
+          printer->timeoutSet(n * printer->byteTime);
+          n = 0;
+        }
+      }
+    }
+  }
+  if (n) {
+    printer->timeoutWait();
+    printer->stream->write(buf, n);
+    printer->timeoutSet(n * printer->byteTime);
+  }
+  printer->timeoutWait();
+  printer->timeoutSet(NV_WRITE_TIME);
+  stored = setHash;
+  return true;
+}
+
+void Adafruit_ThermalNV::print(uint8_t index, uint8_t mode) {
+  uint8_t cmd[] = {ASCII_FS, 'p', (uint8_t)(index + 1), (uint8_t)(mode & 3)};
+
+  if (index >= count)
+    return;
+  if (printer->column) // Ignored mid-line, so end the line first
+    printer->feed(1);
+  if (printer->skipOutput())
+    return; // (Not even downloaded while replaying or paused)
+  sync();
+  if (!printer->writeOutput(cmd, sizeof cmd))
+    return;
+  // Rows are whole multiples of 8, doubled in double-height modes.
+  printer->timeoutSet(((images[index].h + 7UL) & ~7UL) * ((mode & 2) ? 2 : 1) *
+                      printer->dotPrintTime);
+  printer->prevByte = '\n';
+}
+
+void Adafruit_ThermalNV::setStoredHash(uint32_t hash) { stored = hash; }
+
+uint32_t Adafruit_ThermalNV::hash() { return setHash; }
+
+uint32_t Adafruit_ThermalNV::storedHash() { return stored; }
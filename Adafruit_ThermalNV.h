@@ -0,0 +1,96 @@
+/*!
+ * @file Adafruit_ThermalNV.h
+ */
+
+#ifndef ADAFRUIT_THERMALNV_H
+#define ADAFRUIT_THERMALNV_H
+
+#include "Adafruit_Thermal.h"
+
+#define NV_MAX_IMAGES 4 //!< Images one registry can hold
+
+// Print modes for Adafruit_ThermalNV::print():
+#define NV_NORMAL 0        //!< Print at 1:1
+#define NV_DOUBLE_WIDTH 1  //!< Print at double width
+#define NV_DOUBLE_HEIGHT 2 //!< Print at double height
+#define NV_QUADRUPLE 3     //!< Print at double width and height
+
+/*!
+ * Registry of bitmaps (e.g. logos) kept in the printer's non-volatile
+ * image memory, so that printing one costs a 4-byte command instead of a
+ * full raster transfer.  The printer only stores a whole set of images at
+ * once, so the registry hashes the set and downloads it again only when
+ * the hash differs from that of the set last downloaded.  NV memory wears
+ * with writes: to avoid a download on every power-up, save storedHash()
+ * (e.g. in EEPROM) and restore it with setStoredHash() at startup.
+ */
+class Adafruit_ThermalNV {
+
+public:
+  /*!
+   * @brief NV image registry constructor
+   * @param printer Printer holding the images
+   */
+  Adafruit_ThermalNV(Adafruit_Thermal *printer);
+
+  int8_t
+    /*!
+     * @brief Adds a bitmap to the registry.  Its data must remain valid and
+     * unchanged while registered.
+     * @param w Width of the image in pixels, up to 384
+     * @param h Height of the image in pixels, up to 2304
+     * @param bitmap Bitmap data, in the same format as printBitmap()
+     * @param fromProgMem True if the bitmap is in PROGMEM
+     * @return Index of the image, or -1 if the registry is full
+     */
+    add(int w, int h, const uint8_t *bitmap, bool fromProgMem=true);
+  bool
+    /*!
+     * @brief Downloads the registered images if the printer doesn't
+     * already hold them.  print() does this as needed.
+     * @return Returns true if the images were downloaded
+     */
+    sync();
+  void
+    /*!
+     * @brief Prints a registered image, downloading the set first if needed
+     * @param index Image index, as returned by add()
+     * @param mode NV_NORMAL, NV_DOUBLE_WIDTH, NV_DOUBLE_HEIGHT or
+     * NV_QUADRUPLE
+     */
+    print(uint8_t index, uint8_t mode=NV_NORMAL),
+    /*!
+     * @brief Removes all images from the registry (but not the printer)
+     */
+    clear(),
+    /*!
+     * @brief Records which image set the printer holds, e.g. at startup
+     * @param hash Value saved from storedHash()
+     */
+    setStoredHash(uint32_t hash);
+  uint32_t
+    /*!
+     * @brief Content hash of the registered images
+     * @return Hash value
+     */
+    hash(),
+    /*!
+     * @brief Content hash of the images the printer holds
+     * @return Hash value, or 0 if unknown
+     */
+    storedHash();
+
+private:
+  friend class Adafruit_ThermalPool; // Reads printer and image sizes
+  struct Image {
+    const uint8_t *data;
+    uint16_t w, h;
+    bool fromProgMem;
+  } images[NV_MAX_IMAGES];
+  Adafruit_Thermal *printer;
+  uint8_t count;
+  uint32_t setHash, // FNV-1a of registered images
+      stored;       // Hash of the images in the printer, 0 if unknown
+};
+
+#endif // ADAFRUIT_THERMALNV_H
@@ -0,0 +1,228 @@
+/*!
+ * @file Adafruit_ThermalPool.cpp
+ *
+ * Interleaved scheduling of jobs across several printers.  Each
+ * printer's timing model (or DTR line, or room in its ring) says when it
+ * can next accept data; poll() repeatedly gives one step to the printer
+ * that has been ready longest, until none are ready.  A step never waits
+ * on the printer: it's a byte of text, a band of bitmap rows no bigger
+ * than POOL_STEP_BYTES (so it doesn't wait on the link either, beyond
+ * the time its own bytes take), a barcode or NV image command, or
+ * something held back (a wake-up or coalesced feed), and it's only taken
+ * once the printer is ready for it.  Since the printers' physical print
+ * time overlaps, aggregate throughput grows with the number of printers
+ * (see host/jobs.cpp for a measurement).
+ */
+
+#include "Adafruit_ThermalPool.h"
+#include "Adafruit_ThermalRing.h"
+
+// Job kinds:
+#define POOL_TEXT 0    //!< Text, a byte per step
+#define POOL_BITMAP 1  //!< Bitmap, a band of rows per step
+#define POOL_BARCODE 2 //!< Barcode, in one step
+#define POOL_NV 3      //!< NV image, in one step
+
+#define BARCODE_LOAD 74 //!< Load of a barcode: default height plus text
+#define RING_ROOM 128   //!< Ring space a step needs, in ring mode
+
+Adafruit_ThermalPool::Adafruit_ThermalPool() : numPrinters(0) {}
+
+bool Adafruit_ThermalPool::addPrinter(Adafruit_Thermal *printer) {
+  if (numPrinters >= POOL_MAX_PRINTERS)
+    return false;
+  Queue *q = &queues[numPrinters++];
+  q->printer = printer;
+  q->head = q->count = 0;
+  q->load = 0;
+  return true;
+}
+
+// Queue for a new job: the given printer's, or if NULL the least-loaded
+// one with room.  Load is measured in bytes of text and dot rows of
+// everything else, a fair proxy for print time when the printers are
+// alike (a full line of text is about as many dot rows as characters).
+int8_t Adafruit_ThermalPool::pick(Adafruit_Thermal *printer) {
+  int8_t best = -1;
+  for (uint8_t i = 0; i < numPrinters; i++) {
+    if ((queues[i].count < POOL_MAX_JOBS) &&
+        (printer ? (queues[i].printer == printer)
+                 : ((best < 0) || (queues[i].load < queues[best].load))))
+      best = i;
+  }
+  return best;
+}
+
+Adafruit_ThermalPool::Job *Adafruit_ThermalPool::add(int8_t index,
+                                                     uint8_t kind,
+                                                     unsigned long load) {
+  Queue *q = &queues[index];
+  Job *j = &q->jobs[(q->head + q->count++) % POOL_MAX_JOBS];
+  j->kind = kind;
+  j->fromProgMem = j->started = false;
+  q->load += load;
+  return j;
+}
+
+int8_t Adafruit_ThermalPool::submit(const char *text, bool fromProgMem) {
+  int8_t best = pick(NULL);
+  if (best >= 0) {
+    Job *j = add(best, POOL_TEXT, fromProgMem ? strlen_P(text) : strlen(text));
+    j->text = text;
+    j->fromProgMem = fromProgMem;
+  }
+  return best;
+}
+
+int8_t Adafruit_ThermalPool::submit(const __FlashStringHelper *text) {
+  return submit((const char *)text, true);
+}
+
+int8_t Adafruit_ThermalPool::submitBitmap(int w, int h, const uint8_t *bitmap,
+                                          bool fromProgMem) {
+  int8_t best = pick(NULL);
+  if ((best >= 0) && (h > 0)) {
+    Job *j = add(best, POOL_BITMAP, h);
+    j->rows = bitmap;
+    j->w = w;
+    j->h = h;
+    j->fromProgMem = fromProgMem;
+  }
+  return best;
+}
+
+int8_t Adafruit_ThermalPool::submitBarcode(const char *text, uint8_t type) {
+  int8_t best = pick(NULL);
+  if (best >= 0) {
+    Job *j = add(best, POOL_BARCODE, BARCODE_LOAD);
+    j->text = text;
+    j->w = type;
+  }
+  return best;
+}
+
+int8_t Adafruit_ThermalPool::submitNV(Adafruit_ThermalNV *nv, uint8_t index,
+                                      uint8_t mode) {
+  int8_t best = pick(nv->printer);
+  if ((best >= 0) && (index < nv->count)) {
+    unsigned long rows = (nv->images[index].h + 7UL) & ~7UL;
+    Job *j = add(best, POOL_NV, (mode & NV_DOUBLE_HEIGHT) ? 2 * rows : rows);
+    j->nv = nv;
+    j->w = index;
+    j->h = mode;
+  } else {
+    best = -1;
+  }
+  return best;
+}
+
+// Microseconds until the printer can take the next step of its current
+// job without waiting; zero or negative if it can now.  In ring mode
+// the wait is for room in the ring, since service() does the pacing.
+long Adafruit_ThermalPool::readyIn(Queue *q) {
+  Adafruit_Thermal *p = q->printer;
+  Job *j = &q->jobs[q->head];
+
+  if (p->ring) {
+    uint16_t need = RING_ROOM;
+    if (j->kind == POOL_BARCODE)
+      need += strlen(j->text);
+    return (p->ring->room() >= need) ? 0 : 1;
+  }
+  return p->waitTime();
+}
+
+// Give the printer one step of its current job.
+void Adafruit_ThermalPool::step(Queue *q) {
+  Adafruit_Thermal *p = q->printer;
+  Job *j = &q->jobs[q->head];
+  bool done = true;
+  char c;
+  int n;
+
+  // Anything held back goes first, as a step of its own, since it leaves
+  // the printer busy.  So does ending a line, which barcodes and NV
+  // images need (the printer would otherwise be waited on to print it).
+  if (p->wakePending) {
+    p->finishWake();
+    return;
+  }
+  if (p->pendingFeed) {
+    p->flushFeed();
+    return;
+  }
+  if (p->column && ((j->kind == POOL_BARCODE) || (j->kind == POOL_NV))) {
+    p->feed(1);
+    return;
+  }
+
+  switch (j->kind) {
+  case POOL_TEXT:
+    c = j->fromProgMem ? pgm_read_byte(j->text) : *j->text;
+    if (c) {
+      p->write(c);
+      j->text++;
+      q->load--;
+      done = false;
+    }
+    break;
+  case POOL_BITMAP:
+    n = p->printBand(j->w, j->h, j->rows, j->fromProgMem,
+                     p->ring ? p->ring->room() : POOL_STEP_BYTES, j->started);
+    j->rows += (long)n * ((j->w + 7) / 8);
+    j->h -= n;
+    j->started = true;
+    q->load -= n;
+    done = !j->h;
+    break;
+  case POOL_BARCODE:
+    p->printBarcode(j->text, j->w);
+    q->load -= BARCODE_LOAD;
+    break;
+  case POOL_NV:
+    j->nv->print(j->w, j->h);
+    n = (j->nv->images[j->w].h + 7) & ~7;
+    q->load -= (j->h & NV_DOUBLE_HEIGHT) ? 2 * n : n;
+    break;
+  }
+
+  if (done) { // End of job
+    q->head = (q->head + 1) % POOL_MAX_JOBS;
+    q->count--;
+  }
+}
+
+bool Adafruit_ThermalPool::poll() {
+  for (;;) {
+    // Pick the printer that has been ready for data the longest:
+    int8_t best = -1;
+    long bestWait = 1;
+    for (uint8_t i = 0; i < numPrinters; i++) {
+      if (queues[i].count) {
+        long w = readyIn(&queues[i]);
+        if (w < bestWait) {
+          best = i;
+          bestWait = w;
+        }
+      }
+    }
+    if (best < 0)
+      break; // Every printer with work is busy
+    step(&queues[best]);
+  }
+
+  for (uint8_t i = 0; i < numPrinters; i++) {
+    if (queues[i].count)
+      return true;
+  }
+  return false;
+}
+
+unsigned long Adafruit_ThermalPool::pending(uint8_t index) {
+  return (index < numPrinters) ? queues[index].load : 0;
+}
+
+void Adafruit_ThermalPool::run() {
+  while (poll())
+    yield();
+}
@@ -0,0 +1,121 @@
+/*!
+ * @file Adafruit_ThermalPool.h
+ */
+
+#ifndef ADAFRUIT_THERMALPOOL_H
+#define ADAFRUIT_THERMALPOOL_H
+
+#include "Adafruit_Thermal.h"
+#include "Adafruit_ThermalNV.h"
+
+#define POOL_MAX_PRINTERS 4 //!< Printers one pool can drive
+#define POOL_MAX_JOBS 8     //!< Jobs queued per printer
+#define POOL_STEP_BYTES 64  //!< Most bytes one step sends (a UART's FIFO)
+
+/*!
+ * Drives several printers from one controller.  Jobs (text, bitmaps,
+ * barcodes and NV images) are queued to the least-loaded printer, and
+ * poll() feeds whichever printers can accept data right now, a step at a
+ * time, so each prints at full speed instead of the printers taking
+ * turns blocking in timeoutWait().
+ */
+class Adafruit_ThermalPool {
+
+public:
+  Adafruit_ThermalPool();
+
+  bool
+    /*!
+     * @brief Adds a printer (already started with begin()) to the pool
+     * @param printer Printer to add
+     * @return Returns false if the pool is full
+     */
+    addPrinter(Adafruit_Thermal *printer),
+    /*!
+     * @brief Feeds queued data to every printer that can accept it,
+     * without waiting on any of them
+     * @return Returns true if any jobs remain
+     */
+    poll();
+  int8_t
+    /*!
+     * @brief Queues a text job on the least-loaded printer
+     * @param text Job text, which must remain valid until printed
+     * @param fromProgMem True if the text is in PROGMEM
+     * @return Index of the chosen printer, or -1 if all queues are full
+     */
+    submit(const char *text, bool fromProgMem=false),
+    /*!
+     * @brief Queues a text job on the least-loaded printer
+     * @param text Job text (e.g. F("...")), in PROGMEM
+     * @return Index of the chosen printer, or -1 if all queues are full
+     */
+    submit(const __FlashStringHelper *text),
+    /*!
+     * @brief Queues a bitmap on the least-loaded printer
+     * @param w Width in pixels
+     * @param h Height in pixels
+     * @param bitmap Rows, as for printBitmap(); must remain valid until
+     * printed
+     * @param fromProgMem True if the bitmap is in PROGMEM
+     * @return Index of the chosen printer, or -1 if all queues are full
+     */
+    submitBitmap(int w, int h, const uint8_t *bitmap, bool fromProgMem=true),
+    /*!
+     * @brief Queues a barcode on the least-loaded printer
+     * @param text Barcode data, which must remain valid until printed
+     * @param type Barcode type, as for printBarcode()
+     * @return Index of the chosen printer, or -1 if all queues are full
+     */
+    submitBarcode(const char *text, uint8_t type),
+    /*!
+     * @brief Queues an NV image on the registry's own printer.  Call
+     * sync() on the registry first: downloading images can't be done a
+     * step at a time.
+     * @param nv Image registry
+     * @param index Image index, as for Adafruit_ThermalNV::print()
+     * @param mode NV_NORMAL, NV_DOUBLE_WIDTH etc.
+     * @return Index of the printer, or -1 if it isn't in the pool or its
+     * queue is full
+     */
+    submitNV(Adafruit_ThermalNV *nv, uint8_t index, uint8_t mode=NV_NORMAL);
+  unsigned long
+    /*!
+     * @brief Work not yet sent to a printer
+     * @param index Printer index, in the order added
+     * @return Bytes of text, plus dot rows of bitmaps, barcodes and NV
+     * images, remaining across the printer's queued jobs
+     */
+    pending(uint8_t index);
+  void
+    /*!
+     * @brief Runs poll() until all queued jobs have been sent
+     */
+    run();
+
+private:
+  struct Job {
+    union {
+      const char *text;       // Text still to send, or barcode data
+      const uint8_t *rows;    // Bitmap rows still to send
+      Adafruit_ThermalNV *nv; // Registry holding the NV image
+    };
+    int w, h;         // Bitmap width, rows left; barcode type; NV index, mode
+    uint8_t kind;     // POOL_TEXT, POOL_BITMAP, POOL_BARCODE or POOL_NV
+    bool fromProgMem, // True if text or rows are in PROGMEM
+        started;      // True once a bitmap's first band is sent
+  };
+  struct Queue {
+    Adafruit_Thermal *printer;
+    Job jobs[POOL_MAX_JOBS]; // Circular, oldest first
+    uint8_t head, count;
+    unsigned long load;      // Unsent work in all queued jobs
+  } queues[POOL_MAX_PRINTERS];
+  uint8_t numPrinters;
+  int8_t pick(Adafruit_Thermal *printer);
+  Job *add(int8_t index, uint8_t kind, unsigned long load);
+  long readyIn(Queue *q);
+  void step(Queue *q);
+};
+
+#endif // ADAFRUIT_THERMALPOOL_H
@@ -0,0 +1,473 @@
+/*!
+ * @file Adafruit_ThermalQR.cpp
+ *
+ * QR code (ISO/IEC 18004) encoder for small microcontrollers.  The only
+ * state kept between encoding and printing is the module matrix, one bit
+ * per module; the codeword buffer lives on the stack during encode().
+ * Function patterns (finders, timing, alignment, format and version
+ * areas) are recognised arithmetically by isFunction() rather than with a
+ * second bitmap, and each candidate mask is applied, scored and removed
+ * again in place.  Codewords are read out of the block-by-block buffer in
+ * interleaved order as they're placed, instead of being reshuffled.
+ */
+
+#include "Adafruit_ThermalQR.h"
+
+#define QUIET 4 // Quiet zone width in modules
+
+// Error correction codewords per block, and number of blocks, for each
+// error correction level (L, M, Q, H) and version (1-40).
+static const uint8_t PROGMEM eccPerBlock[4][40] = {
+    {7,  10, 15, 20, 26, 18, 20, 24, 30, 18, 20, 24, 26, 30,
+     22, 24, 28, 30, 28, 28, 28, 28, 30, 30, 26, 28, 30, 30,
+     30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30},
+    {10, 16, 26, 18, 24, 16, 18, 22, 22, 26, 30, 22, 22, 24,
+     24, 28, 28, 26, 26, 26, 26, 28, 28, 28, 28, 28, 28, 28,
+     28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28},
+    {13, 22, 18, 26, 18, 24, 18, 22, 20, 24, 28, 26, 24, 20,
+     30, 24, 28, 28, 26, 30, 28, 30, 30, 30, 30, 28, 30, 30,
+     30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30},
+    {17, 28, 22, 16, 22, 28, 26, 26, 24, 28, 24, 28, 22, 24,
+     24, 30, 28, 28, 26, 28, 30, 24, 30, 30, 30, 30, 30, 30,
+     30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30}};
+static const uint8_t PROGMEM numBlocks[4][40] = {
+    {1,  1,  1,  1,  1,  2,  2,  2,  2,  4,  4,  4,  4,  4,
+     6,  6,  6,  6,  7,  8,  8,  9,  9,  10, 12, 12, 12, 13,
+     14, 15, 16, 17, 18, 19, 19, 20, 21, 22, 24, 25},
+    {1,  1,  1,  2,  2,  4,  4,  4,  5,  5,  5,  8,  9,  9,
+     10, 10, 11, 13, 14, 16, 17, 17, 18, 20, 21, 23, 25, 26,
+     28, 29, 31, 33, 35, 37, 38, 40, 43, 45, 47, 49},
+    {1,  1,  2,  2,  4,  4,  6,  6,  8,  8,  8,  10, 12, 16,
+     12, 17, 16, 18, 21, 20, 23, 23, 25, 27, 29, 34, 34, 35,
+     38, 40, 43, 45, 48, 51, 53, 56, 59, 62, 65, 68},
+    {1,  1,  2,  4,  4,  4,  5,  6,  8,  8,  11, 11, 16, 16,
+     18, 16, 19, 21, 25, 25, 25, 34, 30, 32, 35, 37, 40, 42,
+     45, 48, 51, 54, 57, 60, 63, 66, 70, 74, 77, 81}};
+
+// Reed-Solomon arithmetic over GF(2^8), polynomial x^8+x^4+x^3+x^2+1.
+static uint8_t gfMultiply(uint8_t x, uint8_t y) {
+  uint8_t z = 0;
+  for (int8_t i = 7; i >= 0; i--) {
+    z = (z << 1) ^ ((z >> 7) * 0x1D);
+    if ((y >> i) & 1)
+      z ^= x;
+  }
+  return z;
+}
+
+// Generator polynomial of the given degree, highest term (1) omitted.
+static void rsDivisor(uint8_t *gen, uint8_t degree) {
+  uint8_t root = 1;
+  memset(gen, 0, degree);
+  gen[degree - 1] = 1;
+  for (uint8_t i = 0; i < degree; i++) {
+    for (uint8_t j = 0; j < degree; j++) {
+      gen[j] = gfMultiply(gen[j], root);
+      if (j + 1 < degree)
+        gen[j] ^= gen[j + 1];
+    }
+    root = gfMultiply(root, 0x02);
+  }
+}
+
+static void rsRemainder(const uint8_t *data, uint8_t len, const uint8_t *gen,
+                        uint8_t degree, uint8_t *ecc) {
+  memset(ecc, 0, degree);
+  while (len--) {
+    uint8_t factor = *data++ ^ ecc[0];
+    memmove(ecc, ecc + 1, degree - 1);
+    ecc[degree - 1] = 0;
+    for (uint8_t j = 0; j < degree; j++)
+      ecc[j] ^= gfMultiply(gen[j], factor);
+  }
+}
+
+static void putBits(uint8_t *buf, uint16_t *pos, uint16_t val, uint8_t n) {
+  while (n--) {
+    if ((val >> n) & 1)
+      buf[*pos >> 3] |= 0x80 >> (*pos & 7);
+    (*pos)++;
+  }
+}
+
+Adafruit_ThermalQR::Adafruit_ThermalQR() : ver(0), sz(0) {}
+
+uint16_t Adafruit_ThermalQR::codewords(uint8_t version) {
+  return QR_RAW_MODULES((uint16_t)version) / 8;
+}
+
+bool Adafruit_ThermalQR::encode(const char *text, uint8_t ecc) {
+  return encode((const uint8_t *)text, strlen(text), ecc, false);
+}
+
+bool Adafruit_ThermalQR::encode(const __FlashStringHelper *text,
+                                uint8_t ecc) {
+  const char *p = (const char *)text;
+  return encode((const uint8_t *)p, strlen_P(p), ecc, true);
+}
+
+bool Adafruit_ThermalQR::encode(const uint8_t *data, uint16_t len,
+                                uint8_t ecc, bool fromProgMem) {
+  uint8_t cw[QR_MAX_CODEWORDS], gen[30], v, blocks, eccLen, numShort,
+      shortLen, b, mask, bestMask;
+  uint16_t dataLen, raw, pos, i;
+  unsigned long p, bestPenalty;
+
+  ecc &= 3;
+  ver = sz = 0;
+
+  // Smallest version whose data capacity holds the mode indicator,
+  // character count and data.
+  for (v = 1;; v++) {
+    if (v > QR_MAX_VERSION)
+      return false;
+    blocks = pgm_read_byte(&numBlocks[ecc][v - 1]);
+    eccLen = pgm_read_byte(&eccPerBlock[ecc][v - 1]);
+    dataLen = codewords(v) - blocks * eccLen;
+    if (4 + ((v < 10) ? 8 : 16) + 8UL * len <= 8UL * dataLen)
+      break;
+  }
+
+  // Byte mode segment, terminator and pad bytes.
+  memset(cw, 0, dataLen);
+  pos = 0;
+  putBits(cw, &pos, 0x4, 4);
+  putBits(cw, &pos, len, (v < 10) ? 8 : 16);
+  for (i = 0; i < len; i++)
+    putBits(cw, &pos, fromProgMem ? pgm_read_byte(data + i) : data[i], 8);
+  pos = (pos + 4 < dataLen * 8) ? pos + 4 : dataLen * 8;
+  for (i = (pos + 7) / 8, b = 0xEC; i < dataLen; i++, b ^= 0xEC ^ 0x11)
+    cw[i] = b;
+
+  // Error correction for each block, appended block by block.  The
+  // first numShort blocks hold one data codeword fewer than the rest.
+  raw = codewords(v);
+  numShort = blocks - raw % blocks;
+  shortLen = raw / blocks - eccLen;
+  rsDivisor(gen, eccLen);
+  for (b = 0, pos = 0; b < blocks; b++) {
+    uint8_t n = shortLen + (b >= numShort);
+    rsRemainder(&cw[pos], n, gen, eccLen, &cw[dataLen + b * eccLen]);
+    pos += n;
+  }
+
+  ver = v;
+  sz = QR_SIZE(v);
+  ecl = ecc;
+  alignCount = alignStep = 0;
+  if (v >= 2) {
+    alignCount = v / 7 + 2;
+    alignStep = (v == 32) ? 26
+                          : (v * 4 + alignCount * 2 + 1) /
+                                (alignCount * 2 - 2) * 2;
+  }
+  memset(matrix, 0, (sz * sz + 7) / 8);
+  drawFunctionPatterns();
+  drawCodewords(cw, dataLen, blocks, eccLen);
+
+  // Keep the mask with the lowest penalty score.
+  bestMask = 0;
+  bestPenalty = ~0UL;
+  for (mask = 0; mask < 8; mask++) {
+    applyMask(mask);
+    drawFormat(mask);
+    p = penalty();
+    if (p < bestPenalty) {
+      bestPenalty = p;
+      bestMask = mask;
+    }
+    applyMask(mask); // XOR again to undo
+  }
+  applyMask(bestMask);
+  drawFormat(bestMask);
+
+  return true;
+}
+
+uint8_t Adafruit_ThermalQR::version() { return ver; }
+
+uint8_t Adafruit_ThermalQR::size() { return sz; }
+
+bool Adafruit_ThermalQR::module(uint8_t x, uint8_t y) {
+  uint16_t i = (uint16_t)y * sz + x;
+  return (matrix[i >> 3] >> (7 - (i & 7))) & 1;
+}
+
+void Adafruit_ThermalQR::set(uint8_t x, uint8_t y, bool dark) {
+  uint16_t i = (uint16_t)y * sz + x;
+  if (dark)
+    matrix[i >> 3] |= 0x80 >> (i & 7);
+  else
+    matrix[i >> 3] &= ~(0x80 >> (i & 7));
+}
+
+// Alignment pattern centres are 6, then evenly spaced from the far edge
+// in; alignIndex() returns which one (if any) coordinate c falls within.
+uint8_t Adafruit_ThermalQR::alignPosition(uint8_t i) {
+  return i ? (sz - 7 - (alignCount - 1 - i) * alignStep) : 6;
+}
+
+int8_t Adafruit_ThermalQR::alignIndex(uint8_t c) {
+  if (!alignCount)
+    return -1;
+  if ((c >= 4) && (c <= 8))
+    return 0;
+  if (c > sz - 5)
+    return -1;
+  uint8_t d = sz - 5 - c; // Distance in from the last pattern's edge
+  if ((d % alignStep) > 4 || (d / alignStep) > alignCount - 2)
+    return -1;
+  return alignCount - 1 - d / alignStep;
+}
+
+bool Adafruit_ThermalQR::isFunction(uint8_t x, uint8_t y) {
+  if ((x == 6) || (y == 6)) // Timing
+    return true;
+  if ((x < 9) && ((y < 9) || (y >= sz - 8))) // Finders, separators, format
+    return true;
+  if ((y < 9) && (x >= sz - 8))
+    return true;
+  if ((ver >= 7) &&
+      (((x < 6) && (y >= sz - 11)) || ((y < 6) && (x >= sz - 11))))
+    return true; // Version
+  int8_t i = alignIndex(x), j = alignIndex(y), last = alignCount - 1;
+  return (i >= 0) && (j >= 0) && !((i == 0) && (j == 0)) &&
+         !((i == 0) && (j == last)) && !((i == last) && (j == 0));
+}
+
+void Adafruit_ThermalQR::drawPattern(uint8_t cx, uint8_t cy, uint8_t r) {
+  for (int8_t dy = -r; dy <= r; dy++) {
+    for (int8_t dx = -r; dx <= r; dx++) {
+      int x = cx + dx, y = cy + dy;
+      if ((x < 0) || (y < 0) || (x >= sz) || (y >= sz))
+        continue;
+      uint8_t ax = (dx < 0) ? -dx : dx, ay = (dy < 0) ? -dy : dy,
+              dist = (ax > ay) ? ax : ay;
+      set(x, y, (r == 4) ? ((dist != 2) && (dist != 4)) : (dist != 1));
+    }
+  }
+}
+
+void Adafruit_ThermalQR::drawFunctionPatterns() {
+  uint8_t i, j, last = alignCount - 1;
+
+  for (i = 0; i < sz; i++) {
+    set(6, i, !(i & 1));
+    set(i, 6, !(i & 1));
+  }
+  drawPattern(3, 3, 4);
+  drawPattern(sz - 4, 3, 4);
+  drawPattern(3, sz - 4, 4);
+  for (i = 0; i < alignCount; i++) {
+    for (j = 0; j < alignCount; j++) {
+      if (!((i == 0) && (j == 0)) && !((i == 0) && (j == last)) &&
+          !((i == last) && (j == 0)))
+        drawPattern(alignPosition(i), alignPosition(j), 2);
+    }
+  }
+
+  if (ver >= 7) { // 6-bit version, 12-bit BCH code
+    unsigned long bits;
+    uint16_t rem = ver;
+    for (i = 0; i < 12; i++)
+      rem = (rem << 1) ^ ((rem >> 11) * 0x1F25);
+    bits = ((unsigned long)ver << 12) | rem;
+    for (i = 0; i < 18; i++) {
+      bool bit = (bits >> i) & 1;
+      set(sz - 11 + i % 3, i / 3, bit);
+      set(i / 3, sz - 11 + i % 3, bit);
+    }
+  }
+}
+
+// Level and mask, 10-bit BCH code, written twice around the finders.
+void Adafruit_ThermalQR::drawFormat(uint8_t mask) {
+  static const uint8_t PROGMEM levelBits[] = {1, 0, 3, 2};
+  uint16_t data = (pgm_read_byte(&levelBits[ecl]) << 3) | mask, rem = data,
+           bits;
+  uint8_t i;
+
+  for (i = 0; i < 10; i++)
+    rem = (rem << 1) ^ ((rem >> 9) * 0x537);
+  bits = ((data << 10) | rem) ^ 0x5412;
+
+  for (i = 0; i <= 5; i++)
+    set(8, i, (bits >> i) & 1);
+  set(8, 7, (bits >> 6) & 1);
+  set(8, 8, (bits >> 7) & 1);
+  set(7, 8, (bits >> 8) & 1);
+  for (i = 9; i < 15; i++)
+    set(14 - i, 8, (bits >> i) & 1);
+
+  for (i = 0; i < 8; i++)
+    set(sz - 1 - i, 8, (bits >> i) & 1);
+  for (i = 8; i < 15; i++)
+    set(8, sz - 15 + i, (bits >> i) & 1);
+  set(8, sz - 8, true); // Always dark
+}
+
+// Codewords go in two-module-wide columns, zigzagging up and down from
+// the bottom right, skipping function modules.  The final sequence takes
+// the i'th data codeword of each block in turn, then likewise the error
+// correction codewords; the index arithmetic below maps that order back
+// onto the block-by-block buffer.
+void Adafruit_ThermalQR::drawCodewords(const uint8_t *cw, uint16_t dataLen,
+                                       uint8_t blocks, uint8_t eccLen) {
+  uint16_t raw = codewords(ver), full, bit = 0, k, off;
+  uint8_t numShort = blocks - raw % blocks, shortLen = raw / blocks - eccLen,
+          b, c = 0;
+  int right, vert, x, y;
+
+  full = (uint16_t)shortLen * blocks; // Data codewords in whole rounds
+  for (right = sz - 1; right >= 1; right -= 2) {
+    if (right == 6) // Skip the vertical timing pattern
+      right = 5;
+    for (vert = 0; vert < sz; vert++) {
+      for (x = right; x >= right - 1; x--) {
+        y = ((right + 1) & 2) ? vert : sz - 1 - vert;
+        if (isFunction(x, y) || (bit >= raw * 8))
+          continue; // Remainder bits stay light
+        if (!(bit & 7)) {
+          k = bit >> 3;
+          if (k < full) {
+            b = k % blocks;
+            off = b * shortLen + ((b > numShort) ? b - numShort : 0) +
+                  k / blocks;
+          } else if (k < dataLen) { // Last data codeword of a long block
+            b = numShort + (k - full);
+            off = b * shortLen + (b - numShort) + shortLen;
+          } else {
+            k -= dataLen;
+            off = dataLen + (k % blocks) * eccLen + k / blocks;
+          }
+          c = cw[off];
+        }
+        set(x, y, (c >> (7 - (bit & 7))) & 1);
+        bit++;
+      }
+    }
+  }
+}
+
+void Adafruit_ThermalQR::applyMask(uint8_t mask) {
+  uint8_t x, y;
+  bool invert;
+
+  for (y = 0; y < sz; y++) {
+    for (x = 0; x < sz; x++) {
+      if (isFunction(x, y))
+        continue;
+      switch (mask) {
+      case 0:
+        invert = !((x + y) % 2);
+        break;
+      case 1:
+        invert = !(y % 2);
+        break;
+      case 2:
+        invert = !(x % 3);
+        break;
+      case 3:
+        invert = !((x + y) % 3);
+        break;
+      case 4:
+        invert = !((x / 3 + y / 2) % 2);
+        break;
+      case 5:
+        invert = !((uint16_t)x * y % 2 + (uint16_t)x * y % 3);
+        break;
+      case 6:
+        invert = !(((uint16_t)x * y % 2 + (uint16_t)x * y % 3) % 2);
+        break;
+      default:
+        invert = !(((x + y) % 2 + (uint16_t)x * y % 3) % 2);
+        break;
+      }
+      if (invert)
+        set(x, y, !module(x, y));
+    }
+  }
+}
+
+// Penalty score per ISO/IEC 18004 section 7.8.3: runs of five or more,
+// 2x2 blocks, finder-like 1:1:3:1:1 runs and dark/light imbalance.
+unsigned long Adafruit_ThermalQR::penalty() {
+  unsigned long result = 0;
+  uint16_t dark = 0, total = (uint16_t)sz * sz, history;
+  uint8_t pass, i, j, run;
+  bool c, prev = false;
+  long k;
+
+  for (pass = 0; pass < 2; pass++) { // Rows, then columns
+    for (i = 0; i < sz; i++) {
+      run = 0;
+      history = 0;
+      for (j = 0; j < sz; j++) {
+        c = pass ? module(i, j) : module(j, i);
+        if (run && (c == prev)) {
+          if (++run == 5)
+            result += 3;
+          else if (run > 5)
+            result++;
+        } else {
+          run = 1;
+          prev = c;
+        }
+        history = ((history << 1) | c) & 0x7FF;
+        if ((j >= 10) && ((history == 0x5D0) || (history == 0x05D)))
+          result += 40;
+      }
+    }
+  }
+
+  for (i = 0; i < sz; i++) {
+    for (j = 0; j < sz; j++) {
+      c = module(j, i);
+      dark += c;
+      if ((i < sz - 1) && (j < sz - 1) && (c == module(j + 1, i)) &&
+          (c == module(j, i + 1)) && (c == module(j + 1, i + 1)))
+        result += 3;
+    }
+  }
+
+  // 10 points per 5% that the dark proportion strays from 50%.
+  k = labs((long)dark * 20 - (long)total * 10);
+  result += ((k + total - 1) / total - 1) * 10;
+
+  return result;
+}
+
+// Module rows are scaled up on the fly.  Rows arrive in order and each
+// module row repeats for scale dot rows, so the row already in buf is
+// reused until the module row changes.
+const uint8_t *Adafruit_ThermalQR::getRow(void *ctx, int y, uint8_t *buf) {
+  Adafruit_ThermalQR *qr = (Adafruit_ThermalQR *)ctx;
+  int my = y / qr->scale - QUIET, w = (qr->sz + QUIET * 2) * qr->scale, x, d;
+
+  if (my == qr->lastRow)
+    return buf;
+  qr->lastRow = my;
+  memset(buf, 0, (w + 7) / 8);
+  if ((my >= 0) && (my < qr->sz)) {
+    for (x = 0; x < qr->sz; x++) {
+      if (qr->module(x, my)) {
+        for (d = (x + QUIET) * qr->scale; d < (x + QUIET + 1) * qr->scale; d++)
+          buf[d >> 3] |= 0x80 >> (d & 7);
+      }
+    }
+  }
+  return buf;
+}
+
+void Adafruit_ThermalQR::print(Adafruit_Thermal *printer, uint8_t s) {
+  int w;
+
+  if (!sz)
+    return;
+  w = sz + QUIET * 2;
+  if (!s || (s * w > THERMAL_MAX_ROW_BYTES * 8))
+    s = THERMAL_MAX_ROW_BYTES * 8 / w;
+  scale = s;
+  lastRow = -QUIET - 1; // Matches no row
+  printer->printBitmap(w * s, w * s, getRow, this);
+}
@@ -0,0 +1,117 @@
+/*!
+ * @file Adafruit_ThermalQR.h
+ */
+
+#ifndef ADAFRUIT_THERMALQR_H
+#define ADAFRUIT_THERMALQR_H
+
+#include "Adafruit_Thermal.h"
+
+// Largest symbol version (1-40) the static buffers are sized for.  Version
+// 10 (57x57 modules) holds 213 bytes at QR_ECC_M.
+#ifndef QR_MAX_VERSION
+#define QR_MAX_VERSION 10 //!< Largest QR version supported
+#endif
+
+// Error correction levels, recovering roughly 7/15/25/30% damage:
+#define QR_ECC_L 0 //!< Low error correction
+#define QR_ECC_M 1 //!< Medium error correction
+#define QR_ECC_Q 2 //!< Quartile error correction
+#define QR_ECC_H 3 //!< High error correction
+
+#define QR_SIZE(v) (17 + 4 * (v)) //!< Modules per side for version v
+#define QR_MATRIX_BYTES                                                        \
+  ((QR_SIZE(QR_MAX_VERSION) * QR_SIZE(QR_MAX_VERSION) + 7) / 8) //!< Matrix
+#define QR_RAW_MODULES(v)                                                      \
+  ((16 * (v) + 128) * (v) + 64 -                                               \
+   ((v) >= 2 ? (25 * ((v) / 7 + 2) - 10) * ((v) / 7 + 2) - 55 : 0) -          \
+   ((v) >= 7 ? 36 : 0)) //!< Data + ECC modules for version v
+#define QR_MAX_CODEWORDS                                                       \
+  (QR_RAW_MODULES(QR_MAX_VERSION) / 8) //!< Encoder scratch bytes (stack)
+
+/*!
+ * QR code encoder that draws the symbol into a bit-packed module matrix
+ * and prints it through Adafruit_Thermal::printBitmap(), scaling modules
+ * up as each row is sent, so no full-size bitmap is ever built.  Data is
+ * encoded in byte mode; the smallest version that fits is chosen.
+ */
+class Adafruit_ThermalQR {
+
+public:
+  Adafruit_ThermalQR();
+
+  bool
+    /*!
+     * @brief Encodes a string
+     * @param text String to encode
+     * @param ecc Error correction level (QR_ECC_L to QR_ECC_H)
+     * @return Returns false if the data doesn't fit in QR_MAX_VERSION
+     */
+    encode(const char *text, uint8_t ecc=QR_ECC_M),
+    /*!
+     * @brief Encodes a string in PROGMEM
+     * @param text String to encode (e.g. F("..."))
+     * @param ecc Error correction level (QR_ECC_L to QR_ECC_H)
+     * @return Returns false if the data doesn't fit in QR_MAX_VERSION
+     */
+    encode(const __FlashStringHelper *text, uint8_t ecc=QR_ECC_M),
+    /*!
+     * @brief Encodes binary data
+     * @param data Bytes to encode
+     * @param len Number of bytes
+     * @param ecc Error correction level (QR_ECC_L to QR_ECC_H)
+     * @param fromProgMem True if data is in PROGMEM
+     * @return Returns false if the data doesn't fit in QR_MAX_VERSION
+     */
+    encode(const uint8_t *data, uint16_t len, uint8_t ecc=QR_ECC_M,
+           bool fromProgMem=false),
+    /*!
+     * @brief Reads one module of the encoded symbol
+     * @param x Column, 0 at left
+     * @param y Row, 0 at top
+     * @return Returns true for a dark module
+     */
+    module(uint8_t x, uint8_t y);
+  uint8_t
+    /*!
+     * @brief Version of the encoded symbol
+     * @return 1-40, or 0 if nothing has been encoded
+     */
+    version(),
+    /*!
+     * @brief Modules per side of the encoded symbol
+     * @return Size, or 0 if nothing has been encoded
+     */
+    size();
+  void
+    /*!
+     * @brief Prints the encoded symbol, with a 4-module quiet zone
+     * @param printer Printer to print on
+     * @param scale Dots per module, or 0 for the largest that fits 384 dots
+     */
+    print(Adafruit_Thermal *printer, uint8_t scale=0);
+  static uint16_t
+    /*!
+     * @brief Encoder scratch space needed for a version (see encode())
+     * @param version Symbol version, 1-40
+     * @return Data plus error correction bytes
+     */
+    codewords(uint8_t version);
+
+private:
+  uint8_t matrix[QR_MATRIX_BYTES], // Row-major, 1 bit per module, dark = 1
+      ver, sz, ecl, alignCount, alignStep, scale;
+  int16_t lastRow; // Module row held in print()'s row buffer
+  void set(uint8_t x, uint8_t y, bool dark), drawFunctionPatterns(),
+      drawPattern(uint8_t cx, uint8_t cy, uint8_t r), drawFormat(uint8_t mask),
+      drawCodewords(const uint8_t *cw, uint16_t dataLen, uint8_t blocks,
+                    uint8_t eccLen),
+      applyMask(uint8_t mask);
+  bool isFunction(uint8_t x, uint8_t y);
+  int8_t alignIndex(uint8_t c);
+  uint8_t alignPosition(uint8_t i);
+  unsigned long penalty();
+  static const uint8_t *getRow(void *ctx, int y, uint8_t *buf);
+};
+
+#endif // ADAFRUIT_THERMALQR_H
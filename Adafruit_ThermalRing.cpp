@@ -0,0 +1,222 @@
+/*!
+ * @file Adafruit_ThermalRing.cpp
+ *
+ * Single-producer, single-consumer ring of printer records.  Each record
+ * starts with a header byte: 1 to RING_MAX_RUN is a run of that many
+ * data bytes; the rest mark timing annotations followed by their little-
+ * endian arguments.  The producer builds a data run in place past the
+ * published head and publishes it whole (when full, or when a timing
+ * annotation follows), so the consumer never sees a partial record.
+ * head is written only by the producer and tail only by the consumer;
+ * each publishes with release ordering and reads the other's index with
+ * acquire ordering.
+ */
+
+#include "Adafruit_ThermalRing.h"
+
+#define HEADER_DELAY 0x80  //!< Followed by 32-bit delay
+#define HEADER_ROW 0x81    //!< Followed by 16-bit rows, 32-bit row time
+#define HEADER_SYNC 0x82   //!< No arguments
+#define HEADER_SETTLE 0x83 //!< Followed by 32-bit delay
+
+#if defined(__AVR__)
+// 16-bit accesses aren't atomic on AVR, so guard against interrupts
+// (where a producer or consumer might run).
+#include <util/atomic.h>
+static inline uint16_t loadIndex(volatile uint16_t *p) {
+  uint16_t v;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { v = *p; }
+  return v;
+}
+static inline void storeIndex(volatile uint16_t *p, uint16_t v) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { *p = v; }
+}
+#else
+static inline uint16_t loadIndex(volatile uint16_t *p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+static inline void storeIndex(volatile uint16_t *p, uint16_t v) {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+#endif
+
+// A size that isn't a power of two would break the index masking, and
+// one too small for a full run and its header would block the producer
+// forever; either way the ring is left empty (buf NULL, mask 0) rather
+// than failing later.
+Adafruit_ThermalRing::Adafruit_ThermalRing(uint8_t *buffer, uint16_t size)
+    : buf(buffer), mask(size - 1), head(0), tail(0), pos(0), runStart(0),
+      runLen(0) {
+  if (!buffer || (size < RING_MIN_SIZE) || (size > RING_MAX_SIZE) ||
+      (size & (size - 1))) {
+    buf = NULL;
+    mask = 0;
+  }
+}
+
+// Producer side ----------------------------------------------------------
+
+// Bytes free past the producer's write position.
+uint16_t Adafruit_ThermalRing::room() {
+  return mask + 1 - (uint16_t)(pos - loadIndex(&tail));
+}
+
+// True if n more bytes fit past the producer's write position.
+bool Adafruit_ThermalRing::space(uint16_t n) { return room() >= n; }
+
+// Wait for room for n bytes.  Anything built so far is published first,
+// since the consumer can't free space while waiting on it.  Returns false
+// (at once) if the ring is unusable.
+bool Adafruit_ThermalRing::reserve(uint16_t n) {
+  if (!buf)
+    return false;
+  if (space(n))
+    return true;
+  flush();
+  while (!space(n))
+    yield();
+  return true;
+}
+
+void Adafruit_ThermalRing::putValue(unsigned long v) {
+  for (uint8_t i = 0; i < 4; i++, v >>= 8)
+    buf[pos++ & mask] = v;
+}
+
+size_t Adafruit_ThermalRing::write(uint8_t c) {
+  if (!runLen || (runLen >= RING_MAX_RUN) || !space(1)) {
+    flush();
+    if (!reserve(2)) // Header + byte
+      return 0;
+    runStart = pos++;
+  }
+  buf[pos++ & mask] = c;
+  runLen++;
+  return 1;
+}
+
+size_t Adafruit_ThermalRing::write(const uint8_t *buffer, size_t size) {
+  // A block that fits in a record of its own (a bitmap row, say) is put
+  // in one and published: service() paces a row by the record following
+  // its RING_ROW, so any part split off for want of space, or data
+  // appended after it, would be miscounted.
+  if ((size <= RING_MAX_RUN) && (size <= mask) &&
+      (!runLen || (runLen + size > RING_MAX_RUN) || !space(size))) {
+    flush();
+    if (!reserve(1 + size)) // Header + block
+      return 0;
+    runStart = pos++;
+    for (size_t i = 0; i < size; i++)
+      buf[pos++ & mask] = buffer[i];
+    runLen = size;
+    flush();
+    return size;
+  }
+  for (size_t i = 0; i < size; i++) {
+    if (!write(buffer[i]))
+      return i;
+  }
+  return size;
+}
+
+void Adafruit_ThermalRing::flush() {
+  if (runLen) {
+    buf[runStart & mask] = runLen;
+    runLen = 0;
+  }
+  storeIndex(&head, pos);
+}
+
+void Adafruit_ThermalRing::pushDelay(unsigned long us) {
+  flush();
+  if (!reserve(5))
+    return;
+  buf[pos++ & mask] = HEADER_DELAY;
+  putValue(us);
+  storeIndex(&head, pos);
+}
+
+void Adafruit_ThermalRing::pushSettle(unsigned long us) {
+  flush();
+  if (!reserve(5))
+    return;
+  buf[pos++ & mask] = HEADER_SETTLE;
+  putValue(us);
+  storeIndex(&head, pos);
+}
+
+void Adafruit_ThermalRing::pushRow(uint16_t bufferRows,
+                                   unsigned long rowTime) {
+  flush();
+  if (!reserve(7))
+    return;
+  buf[pos++ & mask] = HEADER_ROW;
+  buf[pos++ & mask] = bufferRows;
+  buf[pos++ & mask] = bufferRows >> 8;
+  putValue(rowTime);
+  storeIndex(&head, pos);
+}
+
+void Adafruit_ThermalRing::pushSync() {
+  flush();
+  if (!reserve(1))
+    return;
+  buf[pos++ & mask] = HEADER_SYNC;
+  storeIndex(&head, pos);
+}
+
+// Consumer side ----------------------------------------------------------
+
+uint8_t Adafruit_ThermalRing::peekType() {
+  if (tail == loadIndex(&head))
+    return RING_EMPTY;
+  switch (buf[tail & mask]) {
+  case HEADER_DELAY:
+    return RING_DELAY;
+  case HEADER_ROW:
+    return RING_ROW;
+  case HEADER_SYNC:
+    return RING_SYNC;
+  case HEADER_SETTLE:
+    return RING_SETTLE;
+  default:
+    return RING_RUN;
+  }
+}
+
+unsigned long Adafruit_ThermalRing::getValue(uint16_t p) {
+  unsigned long v = 0;
+  for (uint8_t i = 0; i < 4; i++)
+    v |= (unsigned long)buf[(p + i) & mask] << (8 * i);
+  return v;
+}
+
+uint8_t Adafruit_ThermalRing::readRun(uint8_t *buffer) {
+  uint8_t n = buf[tail & mask];
+  for (uint8_t i = 0; i < n; i++)
+    buffer[i] = buf[(tail + 1 + i) & mask];
+  storeIndex(&tail, tail + 1 + n);
+  return n;
+}
+
+unsigned long Adafruit_ThermalRing::readValue() {
+  unsigned long v = getValue(tail + 1);
+  storeIndex(&tail, tail + 5);
+  return v;
+}
+
+void Adafruit_ThermalRing::readRow(uint16_t *bufferRows,
+                                   unsigned long *rowTime) {
+  *bufferRows = buf[(tail + 1) & mask] | (buf[(tail + 2) & mask] << 8);
+  *rowTime = getValue(tail + 3);
+  storeIndex(&tail, tail + 7);
+}
+
+void Adafruit_ThermalRing::skip() {
+  uint8_t h = buf[tail & mask];
+  uint8_t n = ((h == HEADER_DELAY) || (h == HEADER_SETTLE)) ? 5
+              : (h == HEADER_ROW)                             ? 7
+              : (h == HEADER_SYNC)                            ? 1
+                                                              : 1 + h;
+  storeIndex(&tail, tail + n);
+}
@@ -0,0 +1,149 @@
+/*!
+ * @file Adafruit_ThermalRing.h
+ */
+
+#ifndef ADAFRUIT_THERMALRING_H
+#define ADAFRUIT_THERMALRING_H
+
+#include "Arduino.h"
+
+#define RING_MAX_RUN 64      //!< Max data bytes in one ring record
+#define RING_MIN_SIZE 128    //!< Smallest ring holding a full run + header
+#define RING_MAX_SIZE 32768U //!< Largest ring 16-bit indices can address
+
+// Record types returned by Adafruit_ThermalRing::peekType():
+#define RING_EMPTY 0  //!< Nothing to read
+#define RING_RUN 1    //!< Printer data (readRun())
+#define RING_DELAY 2  //!< Busy time after the preceding data (readValue())
+#define RING_ROW 3    //!< Next run is a bitmap row (readRow())
+#define RING_SYNC 4   //!< Wait for bitmap rows to finish printing (skip())
+#define RING_SETTLE 5 //!< Busy time that DTR doesn't show (readValue())
+
+/*!
+ * Lock-free single-producer, single-consumer ring carrying printer data
+ * together with the timing annotations needed to pace it.  The producer
+ * side is a Stream, so an Adafruit_Thermal can format into it (see
+ * Adafruit_Thermal::setRing()) on one thread or core while the consumer,
+ * Adafruit_Thermal::service(), drains it to the serial port on another.
+ * The producer blocks (calling yield()) while the ring is full.
+ */
+class Adafruit_ThermalRing : public Stream {
+
+public:
+  /*!
+   * @brief Ring constructor
+   * @param buffer Storage for the ring
+   * @param size Size of buffer in bytes; must be a power of two from
+   * RING_MIN_SIZE to RING_MAX_SIZE.  Any other size leaves the ring unusable
+   * (see valid()).
+   */
+  Adafruit_ThermalRing(uint8_t *buffer, uint16_t size);
+
+  /*!
+   * @brief Checks the size given to the constructor
+   * @return Returns false if the size was invalid, in which case the ring
+   * holds nothing, writes to it return 0 and setRing() won't use it
+   */
+  bool valid() { return buf != NULL; }
+
+  // Producer side --------------------------------------------------------
+
+  size_t
+    /*!
+     * @brief Queues one byte of printer data
+     * @param c Byte to queue
+     * @return 1
+     */
+    write(uint8_t c),
+    /*!
+     * @brief Queues a block of printer data
+     * @param buffer Bytes to queue
+     * @param size Number of bytes
+     * @return size
+     */
+    write(const uint8_t *buffer, size_t size);
+  using Print::write;
+  void
+    /*!
+     * @brief Queues the busy time following the data just written
+     * @param us Time in microseconds
+     */
+    pushDelay(unsigned long us),
+    /*!
+     * @brief Queues a wait the printer needs even though its DTR line
+     * says it's ready (e.g. settling after wake-up)
+     * @param us Time in microseconds
+     */
+    pushSettle(unsigned long us),
+    /*!
+     * @brief Marks the next data written as one bitmap row
+     * @param bufferRows Rows the printer can buffer alongside this one
+     * @param rowTime Time to print the row, in microseconds
+     */
+    pushRow(uint16_t bufferRows, unsigned long rowTime),
+    /*!
+     * @brief Queues a wait for all bitmap rows to finish printing
+     */
+    pushSync(),
+    /*!
+     * @brief Makes any partly-built data record visible to the consumer
+     */
+    flush();
+  /*!
+   * @brief Room left for the producer to write without blocking
+   * @return Free bytes, records' own headers included
+   */
+  uint16_t room();
+
+  // Stream input isn't meaningful here; there are no replies to read.
+  int available() { return 0; } //!< Always 0
+  int read() { return -1; }     //!< Always -1
+  int peek() { return -1; }     //!< Always -1
+
+  // Consumer side --------------------------------------------------------
+
+  uint8_t
+    /*!
+     * @brief Type of the next record, without consuming it
+     * @return RING_EMPTY, RING_RUN, RING_DELAY, RING_ROW, RING_SYNC or
+     * RING_SETTLE
+     */
+    peekType(),
+    /*!
+     * @brief Consumes a RING_RUN record
+     * @param buffer Receives up to RING_MAX_RUN data bytes
+     * @return Number of bytes
+     */
+    readRun(uint8_t *buffer);
+  unsigned long
+    /*!
+     * @brief Consumes a RING_DELAY or RING_SETTLE record
+     * @return Busy time in microseconds
+     */
+    readValue();
+  void
+    /*!
+     * @brief Consumes a RING_ROW record
+     * @param bufferRows Receives rows the printer can buffer
+     * @param rowTime Receives time to print the row
+     */
+    readRow(uint16_t *bufferRows, unsigned long *rowTime),
+    /*!
+     * @brief Consumes a record without looking at it (e.g. RING_SYNC)
+     */
+    skip();
+
+private:
+  uint8_t *buf;
+  uint16_t mask;          // size - 1
+  volatile uint16_t head, // Next write position, published by producer
+      tail;               // Next read position, published by consumer
+  uint16_t pos,           // Producer's write position (head + unpublished)
+      runStart;           // Header position of data run being built
+  uint8_t runLen;         // Bytes in data run being built, 0 if none
+  bool space(uint16_t n), reserve(uint16_t n);
+  void putValue(unsigned long v);
+  unsigned long getValue(uint16_t p);
+};
+
+#endif // ADAFRUIT_THERMALRING_H
@@ -0,0 +1,75 @@
+/*!
+ * @file Adafruit_ThermalTrace.cpp
+ *
+ * Dump format, all values little-endian: the magic bytes "THTR", a
+ * format version (1), the event count (1 byte), events dropped (4 bytes)
+ * and total wait time (4 bytes), then each event oldest first as time
+ * (4), value (4), type (1) and size (1).
+ */
+
+#include "Adafruit_ThermalTrace.h"
+
+#define TRACE_VERSION 1 //!< Dump format version
+
+Adafruit_ThermalTrace::Adafruit_ThermalTrace() { clear(); }
+
+void Adafruit_ThermalTrace::clear() {
+  next = used = 0;
+  lost = waited = 0;
+}
+
+void Adafruit_ThermalTrace::add(uint8_t type, unsigned long time,
+                                unsigned long value, uint8_t size) {
+  if (type == TRACE_WAIT) {
+    waited += value;
+    if (value < TRACE_MIN_WAIT)
+      return;
+  } else if ((type == TRACE_WRITE) && used) {
+    // Extends the previous event if that was a write too
+    struct event *e = &events[(next ? next : TRACE_EVENTS) - 1];
+    if (e->type == TRACE_WRITE) {
+      e->value += value;
+      return;
+    }
+  }
+
+  events[next].time = time;
+  events[next].value = value;
+  events[next].type = type;
+  events[next].size = size;
+  if (++next >= TRACE_EVENTS)
+    next = 0;
+  if (used < TRACE_EVENTS)
+    used++;
+  else
+    lost++;
+}
+
+void Adafruit_ThermalTrace::put32(Stream *s, unsigned long v) {
+  for (uint8_t i = 0; i < 4; i++, v >>= 8)
+    s->write((uint8_t)v);
+}
+
+void Adafruit_ThermalTrace::dump(Stream *s) {
+  uint8_t i = (next + TRACE_EVENTS - used) % TRACE_EVENTS;
+
+  s->write((const uint8_t *)"THTR", 4);
+  s->write((uint8_t)TRACE_VERSION);
+  s->write(used);
+  put32(s, lost);
+  put32(s, waited);
+  for (uint8_t n = 0; n < used; n++) {
+    put32(s, events[i].time);
+    put32(s, events[i].value);
+    s->write(events[i].type);
+    s->write(events[i].size);
+    if (++i >= TRACE_EVENTS)
+      i = 0;
+  }
+}
+
+uint8_t Adafruit_ThermalTrace::count() { return used; }
+
+unsigned long Adafruit_ThermalTrace::dropped() { return lost; }
+
+unsigned long Adafruit_ThermalTrace::waitTotal() { return waited; }
@@ -0,0 +1,98 @@
+/*!
+ * @file Adafruit_ThermalTrace.h
+ */
+
+#ifndef ADAFRUIT_THERMALTRACE_H
+#define ADAFRUIT_THERMALTRACE_H
+
+#include "Arduino.h"
+
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS 32 //!< Events held; the oldest are overwritten
+#endif
+// Event indices are bytes, as is the count in dump()'s header.
+#if (TRACE_EVENTS < 1) || (TRACE_EVENTS > 255)
+#error "TRACE_EVENTS must be from 1 to 255"
+#endif
+#ifndef TRACE_MIN_WAIT
+#define TRACE_MIN_WAIT 1000 //!< Shorter waits are only totaled, microseconds
+#endif
+
+// Event types.  Each event has a micros() timestamp and a value:
+#define TRACE_COMMAND 1 //!< Command sent; value holds its bytes, first lowest
+#define TRACE_WRITE 2   //!< Data sent (text, rows); value is the byte count
+#define TRACE_WAIT 3    //!< Waited on the printer; value is the duration
+#define TRACE_CHUNK 4   //!< Bitmap chunk started; value is its row count
+#define TRACE_DTR 5     //!< DTR changed; value is 1 for ready, 0 for busy
+#define TRACE_MARK 6    //!< Added by the sketch; value is up to the sketch
+
+/*!
+ * Fixed-size ring of timestamped events recorded by Adafruit_Thermal (see
+ * Adafruit_Thermal::setTrace()), for finding out afterward why a job
+ * printed badly or slowly: whether data went out faster than the printer
+ * could take it, whether the sketch was slow to supply it, or whether
+ * the library waited longer than it needed to.  Consecutive writes are
+ * merged into one event, and waits shorter than TRACE_MIN_WAIT (e.g. the
+ * per-byte pacing of text) are added to a running total rather than
+ * recorded, so the ring covers more than a few characters.  dump() sends
+ * the events in binary; python/trace_to_chrome.py converts a dump into a
+ * timeline for the Chrome trace viewer (chrome://tracing or Perfetto).
+ */
+class Adafruit_ThermalTrace {
+
+public:
+  /*!
+   * @brief Trace constructor
+   */
+  Adafruit_ThermalTrace();
+
+  void
+    /*!
+     * @brief Records an event
+     * @param type TRACE_COMMAND, TRACE_WRITE etc.
+     * @param time micros() when the event happened (or began)
+     * @param value Type-specific value
+     * @param size Command length for TRACE_COMMAND, row bytes for
+     * TRACE_CHUNK, 0 otherwise
+     */
+    add(uint8_t type, unsigned long time, unsigned long value,
+        uint8_t size=0),
+    /*!
+     * @brief Sends the events held, oldest first, in binary
+     * @param s Stream to send to (e.g. Serial, or an SD card file)
+     */
+    dump(Stream *s),
+    /*!
+     * @brief Discards all events and resets the totals
+     */
+    clear();
+  uint8_t
+    /*!
+     * @brief Number of events held
+     * @return Count, up to TRACE_EVENTS
+     */
+    count();
+  unsigned long
+    /*!
+     * @brief Events overwritten since clear()
+     * @return Count of events lost
+     */
+    dropped(),
+    /*!
+     * @brief Total time spent waiting, short waits included
+     * @return Time in microseconds
+     */
+    waitTotal();
+
+private:
+  struct event {
+    unsigned long time, value;
+    uint8_t type, size;
+  } events[TRACE_EVENTS];
+  uint8_t next, // Where the next event goes
+      used;     // Events held
+  unsigned long lost, waited;
+  void put32(Stream *s, unsigned long v);
+};
+
+#endif // ADAFRUIT_THERMALTRACE_H
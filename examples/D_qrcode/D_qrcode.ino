@@ -0,0 +1,86 @@
+/*------------------------------------------------------------------------
+  Example sketch for Adafruit Thermal Printer library for Arduino.
+  Encodes and prints QR codes on the microcontroller itself, then times
+  the encoder for versions 1 to 10 and reports its RAM use on the USB
+  serial monitor (115200 baud).
+  See 'A_printertest' sketch for a more generalized printing example.
+  ------------------------------------------------------------------------*/
+
+#include "Adafruit_Thermal.h"
+#include "Adafruit_ThermalQR.h"
+
+// Here's the syntax when using SoftwareSerial (e.g. Arduino Uno) --------
+// If using hardware serial instead, comment out or remove these lines:
+
+#include "SoftwareSerial.h"
+#define TX_PIN 6 // Arduino transmit  YELLOW WIRE  labeled RX on printer
+#define RX_PIN 5 // Arduino receive   GREEN WIRE   labeled TX on printer
+
+SoftwareSerial mySerial(RX_PIN, TX_PIN); // Declare SoftwareSerial obj first
+Adafruit_Thermal printer(&mySerial);     // Pass addr to printer constructor
+// Then see setup() function regarding serial & printer begin() calls.
+
+// Here's the syntax for hardware serial (e.g. Arduino Due) --------------
+// Un-comment the following line if using hardware serial:
+
+//Adafruit_Thermal printer(&Serial1);      // Or Serial2, Serial3, etc.
+
+// -----------------------------------------------------------------------
+
+Adafruit_ThermalQR qr; // Holds one encoded symbol
+
+// Bytes that exactly fill versions 1-10 at QR_ECC_M:
+const uint8_t capacity[] = {14, 26, 42, 62, 84, 106, 122, 152, 180, 213};
+
+void setup() {
+  Serial.begin(115200);
+
+  // This line is for compatibility with the Adafruit IotP project pack,
+  // which uses pin 7 as a spare grounding point.  You only need this if
+  // wired up the same way (w/3-pin header into pins 5/6/7):
+  pinMode(7, OUTPUT); digitalWrite(7, LOW);
+
+  mySerial.begin(19200);  // Initialize SoftwareSerial
+  //Serial1.begin(19200); // Use this instead if using hardware serial
+  printer.begin();        // Init printer (same regardless of serial type)
+
+  printer.justify('C');
+  printer.boldOn();
+  printer.println(F("QR CODE EXAMPLES\n"));
+  printer.boldOff();
+  printer.justify('L');
+
+  // Default: largest module size that fits the paper
+  qr.encode(F("https://www.adafruit.com"));
+  qr.print(&printer);
+  printer.feed(1);
+
+  // Higher error correction makes a bigger symbol; 4 dots per module
+  qr.encode(F("https://www.adafruit.com/product/597"), QR_ECC_H);
+  qr.print(&printer, 4);
+  printer.feed(2);
+
+  // Encoder benchmark.  Symbol RAM is fixed by QR_MAX_VERSION; scratch
+  // is stack, used only while encode() runs.
+  static uint8_t data[213];
+  for (uint16_t i = 0; i < sizeof(data); i++)
+    data[i] = 'A' + (i % 26);
+  Serial.print(F("Symbol RAM: "));
+  Serial.println(sizeof(qr));
+  Serial.println(F("Version  Size  Scratch  Encode (us)"));
+  for (uint8_t v = 1; v <= 10; v++) {
+    unsigned long t = micros();
+    qr.encode(data, capacity[v - 1]);
+    t = micros() - t;
+    Serial.print(qr.version());
+    Serial.print(F("        "));
+    Serial.print(qr.size());
+    Serial.print(F("    "));
+    Serial.print(Adafruit_ThermalQR::codewords(v));
+    Serial.print(F("      "));
+    Serial.println(t);
+  }
+}
+
+void loop() {
+}
@@ -0,0 +1,171 @@
+/*!
+ * @file Arduino.cpp
+ *
+ * Host implementations of the Arduino core functions declared in
+ * Arduino.h.  Time comes from the system's monotonic clock, or from a
+ * virtual clock (see hostVirtualClock()).
+ */
+
+#include "Arduino.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+HardwareSerial Serial;
+int (*hostDigitalRead)(uint8_t pin) = NULL;
+
+static unsigned long long monotonicMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static const unsigned long long startMicros = monotonicMicros();
+static unsigned long long virtualMicros; // Virtual time, if enabled
+static unsigned long yieldStep;          // Virtual time per yield(), or 0
+
+void hostVirtualClock(unsigned long yieldMicros) {
+  if (yieldMicros && !yieldStep)
+    virtualMicros = monotonicMicros() - startMicros; // Carry on from now
+  yieldStep = yieldMicros;
+}
+
+unsigned long micros() {
+  if (yieldStep)
+    return (unsigned long)virtualMicros;
+  return (unsigned long)(monotonicMicros() - startMicros);
+}
+
+unsigned long millis() { return micros() / 1000; }
+
+void delay(unsigned long ms) {
+  if (yieldStep)
+    virtualMicros += ms * 1000ULL;
+  else
+    usleep(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  if (yieldStep)
+    virtualMicros += us;
+  else
+    usleep(us);
+}
+
+// On the real clock, let other threads run (a ring's consumer, say), as
+// yield() lets other tasks run on a board.
+void yield() {
+  if (yieldStep)
+    virtualMicros += yieldStep;
+  else
+    sched_yield();
+}
+
+void pinMode(uint8_t /*pin*/, uint8_t /*mode*/) {}
+
+int digitalRead(uint8_t pin) {
+  return hostDigitalRead ? hostDigitalRead(pin) : LOW;
+}
+
+void digitalWrite(uint8_t /*pin*/, uint8_t /*val*/) {}
+
+// Print ------------------------------------------------------------------
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (write(*buffer++))
+      n++;
+    else
+      break;
+  }
+  return n;
+}
+
+size_t Print::printNumber(unsigned long n, int base) {
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+
+  if (base < 2)
+    base = 10;
+  *str = '\0';
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+
+  return write(str);
+}
+
+size_t Print::print(const __FlashStringHelper *s) {
+  return write((const char *)s);
+}
+
+size_t Print::print(const char *s) { return write(s); }
+
+size_t Print::print(char c) { return write((uint8_t)c); }
+
+size_t Print::print(unsigned char n, int base) {
+  return printNumber(n, base);
+}
+
+size_t Print::print(int n, int base) { return print((long)n, base); }
+
+size_t Print::print(unsigned int n, int base) {
+  return printNumber(n, base);
+}
+
+size_t Print::print(long n, int base) {
+  if ((base == 10) && (n < 0))
+    return print('-') + printNumber(-(unsigned long)n, 10);
+  return printNumber(n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+  return printNumber(n, base);
+}
+
+size_t Print::print(double n, int digits) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return write(buf);
+}
+
+size_t Print::println() { return write("\r\n"); }
+
+size_t Print::println(const __FlashStringHelper *s) {
+  return print(s) + println();
+}
+
+size_t Print::println(const char *s) { return print(s) + println(); }
+
+size_t Print::println(char c) { return print(c) + println(); }
+
+size_t Print::println(unsigned char n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(int n, int base) { return print(n, base) + println(); }
+
+size_t Print::println(unsigned int n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(long n, int base) { return print(n, base) + println(); }
+
+size_t Print::println(unsigned long n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(double n, int digits) {
+  return print(n, digits) + println();
+}
+
+// HardwareSerial ---------------------------------------------------------
+
+size_t HardwareSerial::write(uint8_t c) {
+  return (fputc(c, stdout) == EOF) ? 0 : 1;
+}
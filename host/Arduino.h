@@ -0,0 +1,166 @@
+/*!
+ * @file Arduino.h
+ *
+ * Minimal stand-in for the Arduino core, just enough to build
+ * Adafruit_Thermal (and the tools in this directory) as an ordinary
+ * program on Linux and other POSIX hosts.  Not used on Arduino boards.
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef bool boolean; //!< Arduino's name for bool
+typedef uint8_t byte; //!< Arduino's name for uint8_t
+
+#define HIGH 1         //!< Digital pin high
+#define LOW 0          //!< Digital pin low
+#define INPUT 0        //!< Pin mode: input
+#define OUTPUT 1       //!< Pin mode: output
+#define INPUT_PULLUP 2 //!< Pin mode: input with pullup
+
+#define DEC 10 //!< Decimal number base for print()
+#define HEX 16 //!< Hexadecimal number base for print()
+
+// There's no separate program memory on a host; PROGMEM data is just RAM.
+#define PROGMEM                                      //!< Ignored
+#define PSTR(s) (s)                                  //!< Ignored
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr)) //!< Plain read
+#define memcpy_P memcpy                              //!< Plain memcpy
+#define strlen_P strlen                              //!< Plain strlen
+
+class __FlashStringHelper;
+/*!
+ * Flash-string macro; strings are ordinary RAM strings on a host
+ */
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// Virtual time, for benchmarks and simulations: once enabled, micros()
+// and millis() read a counter that advances only in delay(),
+// delayMicroseconds() and (by yieldMicros per call) yield(), so waits
+// cost no real time.  Pass 0 to return to the system clock.
+void hostVirtualClock(unsigned long yieldMicros);
+
+// There are no GPIO pins on a host.  Reads go through a hook so that
+// tools can emulate an input such as the printer's DTR line.
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t val);
+extern int (*hostDigitalRead)(uint8_t pin); //!< digitalRead() hook, or NULL
+
+/*!
+ * Base class for character output, as in the Arduino core
+ */
+class Print {
+public:
+  virtual ~Print() {}
+  /*!
+   * @brief Writes one byte
+   * @param c Byte to write
+   * @return 1 if written, 0 if not
+   */
+  virtual size_t write(uint8_t c) = 0;
+  /*!
+   * @brief Writes a block of bytes, stopping at the first failed write
+   * @param buffer Bytes to write
+   * @param size Number of bytes
+   * @return Number of bytes written
+   */
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  /*!
+   * @brief Writes a NUL-terminated string
+   * @param str String to write
+   * @return Number of bytes written
+   */
+  size_t write(const char *str) {
+    return str ? write((const uint8_t *)str, strlen(str)) : 0;
+  }
+  /*!
+   * @brief Writes a block of chars
+   * @param buffer Chars to write
+   * @param size Number of chars
+   * @return Number of bytes written
+   */
+  size_t write(const char *buffer, size_t size) {
+    return write((const uint8_t *)buffer, size);
+  }
+  /*!
+   * @brief Waits for pending output, if the device buffers any
+   */
+  virtual void flush() {}
+
+  size_t print(const __FlashStringHelper *s); //!< Prints a string
+  size_t print(const char *s);                //!< Prints a string
+  size_t print(char c);                       //!< Prints a character
+  size_t print(unsigned char n, int base = DEC); //!< Prints a number
+  size_t print(int n, int base = DEC);           //!< Prints a number
+  size_t print(unsigned int n, int base = DEC);  //!< Prints a number
+  size_t print(long n, int base = DEC);          //!< Prints a number
+  size_t print(unsigned long n, int base = DEC); //!< Prints a number
+  size_t print(double n, int digits = 2);        //!< Prints a number
+
+  size_t println();                                //!< Prints a newline
+  size_t println(const __FlashStringHelper *s);    //!< Prints a line
+  size_t println(const char *s);                   //!< Prints a line
+  size_t println(char c);                          //!< Prints a line
+  size_t println(unsigned char n, int base = DEC); //!< Prints a line
+  size_t println(int n, int base = DEC);           //!< Prints a line
+  size_t println(unsigned int n, int base = DEC);  //!< Prints a line
+  size_t println(long n, int base = DEC);          //!< Prints a line
+  size_t println(unsigned long n, int base = DEC); //!< Prints a line
+  size_t println(double n, int digits = 2);        //!< Prints a line
+
+private:
+  size_t printNumber(unsigned long n, int base);
+};
+
+/*!
+ * Base class for bidirectional byte streams, as in the Arduino core
+ */
+class Stream : public Print {
+public:
+  /*!
+   * @brief Number of bytes ready to read
+   * @return Byte count
+   */
+  virtual int available() = 0;
+  /*!
+   * @brief Reads one byte without waiting
+   * @return Byte read, or -1 if none available
+   */
+  virtual int read() = 0;
+  /*!
+   * @brief Returns the next byte without consuming it
+   * @return Next byte, or -1 if none available
+   */
+  virtual int peek() = 0;
+};
+
+/*!
+ * Stand-in for the board's default serial port: output goes to stdout,
+ * and there is never any input.
+ */
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long /*baud*/) {} //!< Ignored
+  size_t write(uint8_t c);              //!< Writes to stdout
+  using Print::write;
+  int available() { return 0; } //!< No input
+  int read() { return -1; }     //!< No input
+  int peek() { return -1; }     //!< No input
+};
+
+extern HardwareSerial Serial; //!< Default serial port (stdout)
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,135 @@
+/*!
+ * @file PosixSerial.cpp
+ *
+ * Stream over a termios file descriptor.  Output is written straight
+ * through (the printer library does its own pacing, so nothing may sit
+ * in a user-space buffer) and block writes go out in a single call.
+ * Input is non-blocking, matching Arduino's read() returning -1 when no
+ * byte is ready, so printer status replies can be polled.
+ */
+
+#include "PosixSerial.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+static speed_t baudConstant(unsigned long baud) {
+  switch (baud) {
+  case 1200:
+    return B1200;
+  case 2400:
+    return B2400;
+  case 4800:
+    return B4800;
+  case 9600:
+    return B9600;
+  case 19200:
+    return B19200;
+  case 38400:
+    return B38400;
+  case 57600:
+    return B57600;
+  case 115200:
+    return B115200;
+  case 230400:
+    return B230400;
+  default:
+    return 0;
+  }
+}
+
+PosixSerial::PosixSerial() : _fd(-1), peekByte(-1) {}
+
+PosixSerial::~PosixSerial() { end(); }
+
+bool PosixSerial::begin(const char *path, unsigned long baud) {
+  int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0)
+    return false;
+  if (!begin(fd, baud)) {
+    close(fd);
+    return false;
+  }
+  return true;
+}
+
+bool PosixSerial::begin(int fd, unsigned long baud) {
+  struct termios tio;
+  speed_t speed = baudConstant(baud);
+
+  if (fd != _fd)
+    end(); // (Calling again on the open descriptor just reconfigures it)
+  if (!speed || (tcgetattr(fd, &tio) < 0))
+    return false;
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+  tio.c_iflag &= ~(IXON | IXOFF | IXANY);
+  tio.c_cc[VMIN] = 0; // Reads return at once, with or without data
+  tio.c_cc[VTIME] = 0;
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  if (tcsetattr(fd, TCSANOW, &tio) < 0)
+    return false;
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+  _fd = fd;
+  peekByte = -1;
+  return true;
+}
+
+void PosixSerial::end() {
+  if (_fd >= 0)
+    close(_fd);
+  _fd = -1;
+}
+
+size_t PosixSerial::write(uint8_t c) { return write(&c, 1); }
+
+// The descriptor is non-blocking, so a full kernel buffer shows up as
+// EAGAIN; wait for room rather than dropping printer data.
+size_t PosixSerial::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while ((_fd >= 0) && (n < size)) {
+    ssize_t r = ::write(_fd, buffer + n, size - n);
+    if (r > 0) {
+      n += r;
+    } else if ((r < 0) && (errno != EAGAIN) && (errno != EINTR)) {
+      break;
+    } else {
+      usleep(100);
+    }
+  }
+  return n;
+}
+
+int PosixSerial::available() {
+  int n = 0;
+  if ((_fd < 0) || (ioctl(_fd, FIONREAD, &n) < 0))
+    n = 0;
+  return n + (peekByte >= 0);
+}
+
+int PosixSerial::read() {
+  uint8_t c;
+  if (peekByte >= 0) {
+    int b = peekByte;
+    peekByte = -1;
+    return b;
+  }
+  return ((_fd >= 0) && (::read(_fd, &c, 1) == 1)) ? c : -1;
+}
+
+int PosixSerial::peek() {
+  if (peekByte < 0)
+    peekByte = read();
+  return peekByte;
+}
+
+void PosixSerial::flush() {
+  if (_fd >= 0)
+    tcdrain(_fd);
+}
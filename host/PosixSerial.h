@@ -0,0 +1,64 @@
+/*!
+ * @file PosixSerial.h
+ *
+ * Arduino Stream over a POSIX serial device (e.g. /dev/ttyUSB0), so that
+ * Adafruit_Thermal can drive a USB-serial printer from a Linux host.
+ */
+
+#ifndef POSIX_SERIAL_H
+#define POSIX_SERIAL_H
+
+#include "Arduino.h"
+
+/*!
+ * Stream implementation over a termios file descriptor
+ */
+class PosixSerial : public Stream {
+public:
+  PosixSerial();
+  ~PosixSerial();
+
+  /*!
+   * @brief Opens and configures a serial device: raw 8N1, no flow control
+   * @param path Device path, e.g. "/dev/ttyUSB0" or a pty
+   * @param baud Baud rate
+   * @return Returns true if successful
+   */
+  bool begin(const char *path, unsigned long baud = 19200);
+  /*!
+   * @brief Uses an already-open descriptor (e.g. one end of a pty pair).
+   * Any other descriptor in use is closed first; passing the one in use
+   * just reconfigures it.
+   * @param fd File descriptor; configured as for begin(path)
+   * @param baud Baud rate
+   * @return Returns true if successful
+   */
+  bool begin(int fd, unsigned long baud = 19200);
+  /*!
+   * @brief Closes the device
+   */
+  void end();
+
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+  using Print::write;
+  int available();
+  int read();
+  int peek();
+  /*!
+   * @brief Waits until all output has been transmitted
+   */
+  void flush();
+
+  /*!
+   * @brief The underlying file descriptor
+   * @return Descriptor, or -1 if not open
+   */
+  int fd() { return _fd; }
+
+private:
+  int _fd;
+  int peekByte; // Byte read ahead by peek(), or -1
+};
+
+#endif // POSIX_SERIAL_H
@@ -0,0 +1,475 @@
+/*!
+ * @file VirtualPrinter.cpp
+ *
+ * Every byte gets two times: when it finishes crossing the link
+ * (arrival), and when the printer's parser takes it out of the input
+ * buffer (consumption) -- the later of its arrival and the parser coming
+ * free.  A byte that completes a printing operation holds the parser for
+ * that operation's duration.  Since both times depend only on earlier
+ * bytes, they're settled as each byte is written, and the buffer's
+ * occupancy at an arrival is the count of earlier bytes not yet consumed.
+ *
+ * Print times follow the heat settings (ESC 7), taking the constructor's
+ * dot print time as that for the library's defaults.  Time per dot row
+ * scales with heat time plus interval, and a bitmap row with more black
+ * dots than may be heated at once is printed in several passes.  A pass
+ * heating more than HEAT_BUDGET dots draws more than the supply gives,
+ * and the row is counted as faded.  So is a text line whose densest dot
+ * row does: each character but a space is taken to ink TEXT_DOTS dots of
+ * its row, more when bold or double width, and the rest of its cell when
+ * inverse.
+ *
+ * Paper is unlimited unless a roll is loaded.  Status replies report
+ * paper out once it's used up, and the operations that would have
+ * printed on it then are counted as lost.
+ */
+
+#include "VirtualPrinter.h"
+
+#define ESC 27
+#define GS 29
+#define DC2 18
+#define FS 28
+
+#define NV_WRITE_TIME 500000UL // Committing FS q images to flash
+#define BUSY_MARGIN 32         // Free buffer below which busy() is true
+#define HEAT_BUDGET 96         // Most dots heated at once without fading
+#define TEXT_DOTS 3            // Densest row's dots in a plain character
+#define BOLD_DOTS 5            // The same, bold
+
+enum {
+  S_IDLE,        // Text, or start of a command
+  S_PREFIX,      // Command byte after ESC, GS, DC2 or FS
+  S_ARGS,        // Fixed arguments
+  S_ROWS,        // DC2 * or GS v 0 bitmap rows
+  S_DATA,        // Payload to skip (GS k with length)
+  S_NUL,         // Payload up to a NUL (old GS k, ESC D)
+  S_NV_HEADER,   // FS q image size
+  S_NV_DATA,     // FS q image data
+  S_GLYPH_WIDTH, // ESC & character width
+  S_GLYPH_DATA   // ESC & character data
+};
+
+VirtualPrinter::VirtualPrinter(unsigned long baud, unsigned long p,
+                               unsigned long f, uint16_t size, uint16_t fifo)
+    : byteTime((10000000UL + baud / 2) / baud), printTime(p), feedTime(f),
+      linkFree(0), parserFree(0), roll(0), paperLeft(0), bufferSize(size),
+      txFifo(fifo), state(S_IDLE), heatDots(11), heatTime(120),
+      heatInterval(40) {
+  resetState();
+  startJob();
+}
+
+void VirtualPrinter::resetState() {
+  column = inked = printMode = sizeMode = hri = inverse = 0;
+  lineHeight = 30;
+  barcodeHeight = 50;
+}
+
+void VirtualPrinter::startJob() {
+  unsigned long now = micros();
+  bytes = overruns = operations = faded = lost = paperUsed = 0;
+  linkBusy = headBusy = headIdle = 0;
+  headStarted = false;
+  jobStart = now;
+  if ((long)(linkFree - now) < 0)
+    linkFree = now;
+  if ((long)(parserFree - now) < 0)
+    parserFree = now;
+}
+
+unsigned long VirtualPrinter::finishTime() {
+  return ((long)(parserFree - linkFree) > 0) ? parserFree : linkFree;
+}
+
+unsigned long VirtualPrinter::jobTime() { return finishTime() - jobStart; }
+
+bool VirtualPrinter::busy() {
+  unsigned long now = micros();
+  while (!pending.empty() && ((long)(pending.front() - now) <= 0))
+    pending.pop_front();
+  return pending.size() + BUSY_MARGIN >= bufferSize;
+}
+
+size_t VirtualPrinter::write(uint8_t c) {
+  unsigned long now = micros(), arrival, consume;
+
+  // The sender blocks while its transmit FIFO is full.
+  if ((long)(linkFree - now) > (long)(txFifo * byteTime)) {
+    delayMicroseconds(linkFree - now - txFifo * byteTime);
+    now = micros();
+  }
+  if ((long)(linkFree - now) < 0)
+    linkFree = now;
+  linkFree += byteTime;
+  linkBusy += byteTime;
+  arrival = linkFree;
+  bytes++;
+
+  while (!pending.empty() && ((long)(pending.front() - arrival) <= 0))
+    pending.pop_front();
+  if (pending.size() >= bufferSize)
+    overruns++;
+
+  consume = ((long)(parserFree - arrival) > 0) ? parserFree : arrival;
+  pending.push_back(consume);
+  parse(c, consume);
+  return 1;
+}
+
+int VirtualPrinter::available() {
+  unsigned long now = micros();
+  int n = 0;
+  for (size_t i = 0; i < replies.size(); i++) {
+    if ((long)(replies[i] - now) <= 0)
+      n++;
+  }
+  return n;
+}
+
+int VirtualPrinter::read() {
+  if (!available())
+    return -1;
+  uint8_t status = replyStatus.front();
+  replies.pop_front();
+  replyStatus.pop_front();
+  return status;
+}
+
+int VirtualPrinter::peek() { return available() ? replyStatus.front() : -1; }
+
+// Status reply for a query parsed now: paper out, or no errors.
+void VirtualPrinter::reply(unsigned long t) {
+  replies.push_back(t);
+  replyStatus.push_back((roll && !paperLeft) ? 0x04 : 0x00);
+}
+
+// The head does one thing at a time, starting once the command's last
+// byte has been consumed and the previous operation is done.  It moves
+// the paper the given number of dot rows; an operation the roll runs out
+// during is lost.
+void VirtualPrinter::op(unsigned long t, unsigned long duration,
+                        unsigned long dots) {
+  unsigned long start = ((long)(parserFree - t) > 0) ? parserFree : t;
+  if (headStarted && ((long)(start - parserFree) > 0))
+    headIdle += start - parserFree;
+  headStarted = true;
+  parserFree = start + duration;
+  headBusy += duration;
+  operations++;
+  if (!roll) {
+    paperUsed += dots;
+  } else if (dots > paperLeft) {
+    paperLeft = 0;
+    lost++;
+  } else {
+    paperLeft -= dots;
+    paperUsed += dots;
+  }
+}
+
+void VirtualPrinter::loadPaper(unsigned long dots) {
+  roll = dots;
+  paperLeft = dots;
+}
+
+// Time to print one dot row of text, barcode etc.
+unsigned long VirtualPrinter::dotTime() {
+  return printTime * (heatTime + heatInterval) / 160;
+}
+
+// Counts a dot row as faded if a pass heats more dots than the supply
+// can give.
+void VirtualPrinter::heat(uint16_t dots) {
+  uint16_t group = 8 * (heatDots + 1);
+  if (((dots < group) ? dots : group) > HEAT_BUDGET)
+    faded++;
+}
+
+// Time to print a bitmap row with the given number of black dots: extra
+// passes are relative to the dots heated at once with the defaults.
+unsigned long VirtualPrinter::rowTime(uint16_t dots) {
+  uint16_t group = 8 * (heatDots + 1), passes = (dots + group - 1) / group,
+      defaultPasses = (dots + 95) / 96;
+  heat(dots);
+  if (!passes)
+    return dotTime();
+  return dotTime() * passes / defaultPasses;
+}
+
+uint8_t VirtualPrinter::charHeight() {
+  uint8_t h = (printMode & 1) ? 17 : 24; // Font B or A
+  if (printMode & 0x10)
+    h *= 2;
+  return h * ((sizeMode & 0x0F) + 1);
+}
+
+// Dots inked in the densest dot row of the text line so far.  Spaces
+// ink nothing, or their whole cell when inverse.
+uint16_t VirtualPrinter::lineDots() {
+  uint8_t cell = (printMode & 1) ? 9 : 12,
+          dots = (printMode & 0x08) ? BOLD_DOTS : TEXT_DOTS,
+          width = ((printMode & 0x20) ? 2 : 1) * ((sizeMode >> 4) + 1);
+  if (inverse || (printMode & 0x02))
+    return (inked * (cell - dots) + (column - inked) * cell) * width;
+  return inked * dots * width;
+}
+
+uint8_t VirtualPrinter::maxColumn() {
+  uint8_t w = (printMode & 1) ? 9 : 12;
+  if (printMode & 0x20)
+    w *= 2;
+  return 384 / (w * ((sizeMode >> 4) + 1));
+}
+
+// Barcode bars, plus a line of human-readable text if enabled.
+void VirtualPrinter::barcode(unsigned long t) {
+  uint16_t rows = barcodeHeight + ((hri & 3) ? 30 : 0);
+  op(t, rows * dotTime(), rows);
+  column = inked = 0;
+}
+
+// Prints the text line, then feeds whatever line spacing remains.
+void VirtualPrinter::printLine(unsigned long t) {
+  uint8_t h = charHeight(), gap = (lineHeight > h) ? lineHeight - h : 0;
+  heat(lineDots());
+  op(t, h * dotTime() + gap * feedTime, h + gap);
+  column = inked = 0;
+}
+
+void VirtualPrinter::parse(uint8_t c, unsigned long t) {
+  switch (state) {
+  case S_IDLE:
+    if ((c == ESC) || (c == GS) || (c == DC2) || (c == FS)) {
+      cmd[0] = c;
+      cmdLen = 1;
+      state = S_PREFIX;
+    } else if (c == '\n') {
+      if (column)
+        printLine(t);
+      else
+        op(t, lineHeight * feedTime, lineHeight);
+    } else if ((c >= ' ') && (c != 0xFF)) {
+      if (column >= maxColumn()) // Wraps
+        printLine(t);
+      column++;
+      if (c != ' ')
+        inked++;
+    } else if (c == '\t') {
+      column = (column + 4) & ~3;
+    }
+    break;
+
+  case S_PREFIX:
+    cmd[cmdLen++] = c;
+    state = S_ARGS;
+    cmdNeed = 0;
+    if (cmd[0] == ESC) {
+      if (strchr("!-3=ERJadtv{ %?", c))
+        cmdNeed = 1;
+      else if (c == '7')
+        cmdNeed = 3;
+      else if (c == '8')
+        cmdNeed = 2;
+      else if (c == '&')
+        cmdNeed = 3;
+      else if (c == 'D')
+        state = S_NUL;
+    } else if (cmd[0] == GS) {
+      if (strchr("!BHahrwk", c))
+        cmdNeed = 1;
+      else if (c == 'v')
+        cmdNeed = 6;
+    } else if (cmd[0] == DC2) {
+      if (c == '#')
+        cmdNeed = 1;
+      else if (c == '*')
+        cmdNeed = 2;
+    } else if (cmd[0] == FS) {
+      if (c == 'p')
+        cmdNeed = 2;
+      else if (c == 'q')
+        cmdNeed = 1;
+    }
+    if ((state == S_ARGS) && !cmdNeed)
+      execute(t);
+    break;
+
+  case S_ARGS:
+    if (cmdLen < sizeof(cmd))
+      cmd[cmdLen++] = c;
+    if (!--cmdNeed)
+      execute(t);
+    break;
+
+  case S_ROWS:
+    for (; c; c &= c - 1)
+      rowDots += ((cmd[1] == 'v') && (cmd[3] & 1)) ? 2 : 1;
+    if (++rowPos == rowBytes) {
+      rowPos = 0;
+      uint8_t tall = ((cmd[1] == 'v') && (cmd[3] & 2)) ? 2 : 1;
+      op(t, rowTime(rowDots) * tall, tall);
+      rowDots = 0;
+    }
+    if (!--dataLeft)
+      state = S_IDLE;
+    break;
+
+  case S_DATA:
+    if (!--dataLeft) {
+      state = S_IDLE;
+      barcode(t);
+    }
+    break;
+
+  case S_NUL:
+    if (!c) {
+      state = S_IDLE;
+      if (cmd[0] == GS)
+        barcode(t);
+    }
+    break;
+
+  case S_NV_HEADER:
+    cmd[cmdLen++] = c;
+    if (cmdLen == 4) {
+      uint16_t x = cmd[0] | (cmd[1] << 8), y = cmd[2] | (cmd[3] << 8);
+      if (nvIndex < 8)
+        nvHeights[nvIndex] = y * 8;
+      dataLeft = (unsigned long)x * y * 8;
+      state = dataLeft ? S_NV_DATA : S_IDLE;
+    }
+    break;
+
+  case S_NV_DATA:
+    if (!--dataLeft) {
+      cmdLen = 0;
+      if (++nvIndex < nvCount) {
+        state = S_NV_HEADER;
+      } else {
+        state = S_IDLE;
+        op(t, NV_WRITE_TIME, 0);
+      }
+    }
+    break;
+
+  case S_GLYPH_WIDTH:
+    dataLeft = (unsigned long)glyphHeight * c;
+    state = dataLeft ? S_GLYPH_DATA : S_IDLE;
+    if (!dataLeft && --glyphsLeft)
+      state = S_GLYPH_WIDTH;
+    break;
+
+  case S_GLYPH_DATA:
+    if (!--dataLeft)
+      state = --glyphsLeft ? S_GLYPH_WIDTH : S_IDLE;
+    break;
+  }
+}
+
+// Runs a command whose arguments are complete.  Payload-carrying
+// commands set up the state that consumes their data.
+void VirtualPrinter::execute(unsigned long t) {
+  uint8_t a = cmd[0], b = cmd[1], n = cmd[2];
+
+  state = S_IDLE;
+  if (a == ESC) {
+    switch (b) {
+    case '@':
+      resetState();
+      break;
+    case '!':
+      printMode = n;
+      break;
+    case '7':
+      heatDots = n;
+      heatTime = cmd[3];
+      heatInterval = cmd[4];
+      break;
+    case '3':
+      lineHeight = n;
+      break;
+    case 'J': {
+      uint8_t h = column ? charHeight() : 0;
+      heat(lineDots());
+      op(t, h * dotTime() + n * feedTime, h + n);
+      column = inked = 0;
+      break;
+    }
+    case 'd':
+      if (column && n) {
+        printLine(t);
+        n--;
+      }
+      op(t, n * lineHeight * feedTime, n * lineHeight);
+      break;
+    case 'v':
+      reply(t);
+      break;
+    case '&':
+      glyphHeight = n;
+      glyphsLeft = cmd[4] - cmd[3] + 1;
+      state = S_GLYPH_WIDTH;
+      break;
+    }
+  } else if (a == GS) {
+    switch (b) {
+    case '!':
+      sizeMode = n;
+      break;
+    case 'B':
+      inverse = n & 1;
+      break;
+    case 'h':
+      barcodeHeight = n;
+      break;
+    case 'H':
+      hri = n;
+      break;
+    case 'r':
+      reply(t);
+      break;
+    case 'k':
+      if (cmdLen == 4) { // Length; data follows
+        dataLeft = cmd[3];
+        if (dataLeft)
+          state = S_DATA;
+        else
+          barcode(t);
+      } else if (n >= 65) { // Length byte comes next
+        cmdNeed = 1;
+        state = S_ARGS;
+      } else { // Data up to a NUL
+        state = S_NUL;
+      }
+      break;
+    case 'v': // GS v 0 m xL xH yL yH
+      rowBytes = cmd[4] | (cmd[5] << 8);
+      dataLeft = (unsigned long)rowBytes * (cmd[6] | (cmd[7] << 8));
+      rowPos = rowDots = 0;
+      state = dataLeft ? S_ROWS : S_IDLE;
+      break;
+    }
+  } else if (a == DC2) {
+    if (b == '*') {
+      rowBytes = cmd[3];
+      dataLeft = (unsigned long)cmd[2] * cmd[3];
+      rowPos = rowDots = 0;
+      state = dataLeft ? S_ROWS : S_IDLE;
+    } else if (b == 'T') {
+      op(t, dotTime() * 24 * 26 + feedTime * (6 * 26 + 30),
+         24 * 26 + 6 * 26 + 30);
+    }
+  } else if (a == FS) {
+    if (b == 'q') {
+      nvCount = n;
+      nvIndex = 0;
+      cmdLen = 0;
+      state = n ? S_NV_HEADER : S_IDLE;
+    } else if ((b == 'p') && n && (n <= nvCount) && (n <= 8)) {
+      unsigned long rows = nvHeights[n - 1] * ((cmd[3] & 2) ? 2 : 1);
+      op(t, rows * dotTime(), rows);
+      column = inked = 0;
+    }
+  }
+}
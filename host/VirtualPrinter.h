@@ -0,0 +1,106 @@
+/*!
+ * @file VirtualPrinter.h
+ *
+ * Timing model of a serial thermal printer, as a Stream the library can
+ * print to on the host's virtual clock (see hostVirtualClock()).  Used to
+ * measure jobs in simulated wall time without a printer attached.
+ */
+
+#ifndef VIRTUAL_PRINTER_H
+#define VIRTUAL_PRINTER_H
+
+#include "Arduino.h"
+
+#include <deque>
+
+/*!
+ * Simulated printer.  Bytes cross a serial link at the configured baud
+ * rate (write() blocks, advancing the clock, once the sending UART's
+ * FIFO is full) into a fixed-size input buffer.  The printer parses the
+ * buffer in order, stalling while the head prints a text line, bitmap
+ * row or barcode, or feeds paper.  A byte that arrives while the buffer
+ * is full is an overrun -- data a real printer would have dropped.
+ * Understands the ESC/POS subset the library sends.
+ */
+class VirtualPrinter : public Stream {
+public:
+  /*!
+   * @brief Virtual printer constructor
+   * @param baud Link speed, 8N1
+   * @param dotPrintTime Time to print one dot row at the library's default
+   * heat settings, microseconds
+   * @param dotFeedTime Time to feed one dot row, microseconds
+   * @param bufferSize Printer input buffer, bytes
+   * @param txFifo Sender's UART transmit buffer, bytes
+   */
+  VirtualPrinter(unsigned long baud = 19200, unsigned long dotPrintTime = 30000,
+                 unsigned long dotFeedTime = 2100, uint16_t bufferSize = 256,
+                 uint16_t txFifo = 64);
+
+  size_t write(uint8_t c);
+  int available();
+  int read();
+  int peek();
+
+  /*!
+   * @brief Starts a new job: clears the statistics below
+   */
+  void startJob();
+  /*!
+   * @brief When the printer will have finished everything sent so far
+   * @return Time in micros()
+   */
+  unsigned long finishTime();
+  /*!
+   * @brief Elapsed time from startJob() until finishTime()
+   * @return Time in microseconds
+   */
+  unsigned long jobTime();
+  /*!
+   * @brief Input buffer occupancy, as a DTR-style busy signal
+   * @return Returns true if the buffer is nearly full at micros()
+   */
+  bool busy();
+  /*!
+   * @brief Loads a new roll of paper
+   * @param dots Length of the roll in dot rows, or 0 for unlimited
+   */
+  void loadPaper(unsigned long dots);
+
+  unsigned long bytes;         //!< Bytes received this job
+  unsigned long overruns;      //!< Bytes that arrived to a full buffer
+  unsigned long operations;    //!< Lines, rows, feeds etc. executed
+  unsigned long faded;         //!< Rows and lines heated past the supply
+  unsigned long lost;          //!< Operations done after the paper ran out
+  unsigned long paperUsed;     //!< Dot rows of paper printed or fed
+  unsigned long long linkBusy; //!< Time the link spent sending, us
+  unsigned long long headBusy; //!< Time the head spent printing or feeding
+  unsigned long long headIdle; //!< Time the head waited for data, us
+
+private:
+  unsigned long byteTime, printTime, feedTime, linkFree, parserFree,
+      jobStart, roll, paperLeft;
+  uint16_t bufferSize, txFifo;
+  bool headStarted;
+  std::deque<unsigned long> pending; // Consume times of buffered bytes
+  std::deque<unsigned long> replies; // Status reply ready times
+  std::deque<uint8_t> replyStatus;   // and their status bytes
+
+  // Parser state
+  uint8_t cmd[8], cmdLen, cmdNeed, state, column, inked, printMode,
+      sizeMode, lineHeight, barcodeHeight, hri, inverse, heatDots, heatTime,
+      heatInterval;
+  unsigned long dataLeft; // Payload bytes left in the current command
+  uint16_t rowBytes, rowPos, rowDots, nvCount, nvIndex, nvHeights[8];
+  uint8_t glyphHeight, glyphsLeft;
+
+  void parse(uint8_t c, unsigned long t), execute(unsigned long t),
+      op(unsigned long t, unsigned long duration, unsigned long dots),
+      printLine(unsigned long t), barcode(unsigned long t), resetState(),
+      reply(unsigned long t), heat(uint16_t dots);
+  uint8_t charHeight(), maxColumn();
+  uint16_t lineDots();
+  unsigned long dotTime(), rowTime(uint16_t dots);
+};
+
+#endif // VIRTUAL_PRINTER_H
@@ -0,0 +1,172 @@
+/*!
+ * @file bench.cpp
+ *
+ * Micro-benchmarks for the library's CPU hot paths, run on the host.
+ * The printer is a Stream that only counts what it receives, pacing is
+ * zeroed (no print or feed time, and a baud rate so high a byte takes no
+ * time) and the library runs on the virtual clock, so the figures are the
+ * library's own processing cost and nothing else.  Each case is repeated
+ * for at least the given time; results are per byte of text, per bitmap
+ * row or per call, along with the bytes and Stream write() calls each
+ * one produces, so changes to the output paths can be compared.
+ *
+ * Build and run (from the library directory):
+ *   g++ -O2 -Ihost -I. Adafruit_Thermal.cpp Adafruit_ThermalRing.cpp \
+ *       Adafruit_ThermalTrace.cpp host/Arduino.cpp host/bench.cpp -o bench
+ *   ./bench [milliseconds per case, default 200]
+ */
+
+#include "Adafruit_Thermal.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+// Printer stand-in: counts bytes and write() calls, discards the data.
+class CountingStream : public Stream {
+public:
+  unsigned long long bytes, calls;
+  CountingStream() : bytes(0), calls(0) {}
+  size_t write(uint8_t /*c*/) {
+    bytes++;
+    calls++;
+    return 1;
+  }
+  size_t write(const uint8_t * /*buffer*/, size_t size) {
+    bytes += size;
+    calls++;
+    return size;
+  }
+  int available() { return 0; }
+  int read() { return -1; }
+  int peek() { return -1; }
+};
+
+// Bitmap source for the Stream overload, replaying one buffer.
+class MemoryStream : public Stream {
+public:
+  const uint8_t *data;
+  size_t size, pos;
+  MemoryStream(const uint8_t *d, size_t n) : data(d), size(n), pos(0) {}
+  size_t write(uint8_t /*c*/) { return 0; }
+  int available() { return size - pos; }
+  int read() { return (pos < size) ? data[pos++] : -1; }
+  int peek() { return (pos < size) ? data[pos] : -1; }
+};
+
+#define BITMAP_W 384 //!< Full printer width
+#define BITMAP_H 64  //!< Rows per printBitmap() call
+#define FILE_H 2560  //!< Rows in the printBitmapFile() banner
+
+static CountingStream sink;
+static Adafruit_Thermal printer(&sink);
+static uint8_t bitmap[BITMAP_W / 8 * BITMAP_H];
+static const uint8_t PROGMEM progmemBitmap[BITMAP_W / 8 * BITMAP_H] = {1};
+static MemoryStream bitmapStream(bitmap, sizeof(bitmap));
+static unsigned long long minNanos;
+
+static unsigned long long nanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Runs op repeatedly for at least minNanos, then reports the cost per
+// unit, where each op covers the given number of units.
+static void bench(const char *name, void (*op)(), unsigned long units,
+                  const char *unit) {
+  unsigned long long start, elapsed, runs = 0, bytes, calls;
+
+  op(); // Warm up
+  bytes = sink.bytes;
+  calls = sink.calls;
+  start = nanos();
+  do {
+    op();
+    runs++;
+    elapsed = nanos() - start;
+  } while (elapsed < minNanos);
+  bytes = sink.bytes - bytes;
+  calls = sink.calls - calls;
+
+  double n = (double)runs * units;
+  printf("%-28s %10.1f ns/%-5s %9.2f bytes/%-5s %8.3f calls/%s\n", name,
+         elapsed / n, unit, bytes / n, unit, calls / n, unit);
+}
+
+static void textLine() { printer.println(F("The quick brown fox jumps over")); }
+
+static void bitmapRam() {
+  printer.printBitmap(BITMAP_W, BITMAP_H, bitmap, false);
+}
+
+static void bitmapProgmem() {
+  printer.printBitmap(BITMAP_W, BITMAP_H, progmemBitmap, true);
+}
+
+static void bitmapStreamed() {
+  bitmapStream.pos = 0;
+  printer.printBitmap(BITMAP_W, BITMAP_H, &bitmapStream);
+}
+
+#if defined(__linux__)
+static char bitmapPath[] = "/tmp/benchXXXXXX"; // Header + bitmap, mmap()ed
+
+static void bitmapFile() { printer.printBitmapFile(bitmapPath); }
+#endif
+
+static void barcode() { printer.printBarcode("ADAFRUT", CODE39); }
+
+static void setDefault() { printer.setDefault(); }
+
+static void setSize() {
+  printer.setSize('L');
+  printer.setSize('S');
+}
+
+static void styles() {
+  printer.boldOn();
+  printer.underlineOn();
+  printer.inverseOn();
+  printer.inverseOff();
+  printer.underlineOff();
+  printer.boldOff();
+}
+
+int main(int argc, char **argv) {
+  minNanos = ((argc > 1) ? strtoul(argv[1], NULL, 0) : 200) * 1000000ULL;
+
+  for (size_t i = 0; i < sizeof(bitmap); i++)
+    bitmap[i] = i * 37;
+
+  hostVirtualClock(1000); // begin()'s startup wait passes instantly
+  printer.begin();
+  printer.setTimes(0, 0);
+  printer.setBaudRate(~0UL); // Rounds byte time down to zero
+
+  printf("%-28s %19s %21s %17s\n", "case", "CPU time", "output", "writes");
+  bench("write() text line", textLine, 31, "byte");
+  bench("printBitmap() RAM 384x64", bitmapRam, BITMAP_H, "row");
+  bench("printBitmap() PROGMEM", bitmapProgmem, BITMAP_H, "row");
+  bench("printBitmap() Stream", bitmapStreamed, BITMAP_H, "row");
+#if defined(__linux__)
+  int fd = mkstemp(bitmapPath);
+  uint8_t header[] = {BITMAP_W & 0xFF, BITMAP_W >> 8, FILE_H & 0xFF,
+                      FILE_H >> 8};
+  bool written = (fd >= 0) && (write(fd, header, 4) == 4);
+  for (int y = 0; written && (y < FILE_H); y += BITMAP_H)
+    written = (write(fd, bitmap, sizeof(bitmap)) == sizeof(bitmap));
+  if (written)
+    bench("printBitmapFile() 384x2560", bitmapFile, FILE_H, "row");
+  if (fd >= 0) {
+    close(fd);
+    unlink(bitmapPath);
+  }
+#endif
+  bench("printBarcode() CODE39", barcode, 1, "call");
+  bench("setDefault()", setDefault, 1, "call");
+  bench("setSize() L, S", setSize, 2, "call");
+  bench("bold/underline/inverse", styles, 6, "call");
+
+  return 0;
+}
@@ -0,0 +1,135 @@
+/*!
+ * @file estimate.cpp
+ *
+ * Timing model accuracy report, run on the host.  Each job -- one kind of
+ * operation apiece, plus a mixed receipt -- is first dry run with
+ * estimate(), then printed for real into VirtualPrinter on the virtual
+ * clock, and the estimated duration is compared with when the simulated
+ * printer actually finished.  A positive error means the library
+ * overestimates (it waits longer than it needs to, costing throughput);
+ * a negative one means it underestimates, and relies on the printer's
+ * buffer to absorb the difference.  Exits nonzero if an estimate's byte
+ * count doesn't match what was actually sent.
+ *
+ * Build and run (from the library directory):
+ *   g++ -O2 -Ihost -I. Adafruit_Thermal.cpp Adafruit_ThermalRing.cpp \
+ *       Adafruit_ThermalTrace.cpp host/Arduino.cpp host/VirtualPrinter.cpp \
+ *       host/estimate.cpp -o estimate
+ *   ./estimate
+ */
+
+#include "Adafruit_Thermal.h"
+#include "VirtualPrinter.h"
+#include "examples/A_printertest/adalogo.h"
+
+#include <stdio.h>
+
+#define TOLERANCE 2.0 //!< Errors within this many percent are reported "ok"
+
+static VirtualPrinter vp;
+static Adafruit_Thermal printer(&vp);
+static uint8_t photo[384 / 8 * 400];
+
+static void textLines(Adafruit_Thermal *p, void * /*ctx*/) {
+  for (uint8_t i = 0; i < 20; i++)
+    p->println(F("Short line of text"));
+}
+
+static void wrappedText(Adafruit_Thermal *p, void * /*ctx*/) {
+  for (uint8_t i = 0; i < 5; i++)
+    p->println(F("A paragraph long enough that the printer has to wrap it "
+                 "several times over before it gets to the end."));
+}
+
+static void largeText(Adafruit_Thermal *p, void * /*ctx*/) {
+  p->setSize('L');
+  for (uint8_t i = 0; i < 8; i++)
+    p->println(F("BIG TEXT"));
+  p->setSize('S');
+}
+
+static void feedLines(Adafruit_Thermal *p, void * /*ctx*/) { p->feed(20); }
+
+static void feedDots(Adafruit_Thermal *p, void * /*ctx*/) {
+  for (uint8_t i = 0; i < 10; i++)
+    p->feedRows(60);
+}
+
+static void logo(Adafruit_Thermal *p, void * /*ctx*/) {
+  p->printBitmap(adalogo_width, adalogo_height, adalogo_data);
+}
+
+static void fullWidth(Adafruit_Thermal *p, void * /*ctx*/) {
+  p->printBitmap(384, 400, photo, false);
+}
+
+static void barcodes(Adafruit_Thermal *p, void * /*ctx*/) {
+  for (uint8_t i = 0; i < 4; i++)
+    p->printBarcode("ADAFRUT", CODE39);
+}
+
+static void testPage(Adafruit_Thermal *p, void * /*ctx*/) { p->testPage(); }
+
+static void receipt(Adafruit_Thermal *p, void * /*ctx*/) {
+  p->justify('C');
+  p->doubleHeightOn();
+  p->println(F("RECEIPT"));
+  p->doubleHeightOff();
+  p->justify('L');
+  p->printBitmap(adalogo_width, adalogo_height, adalogo_data);
+  for (uint8_t i = 0; i < 10; i++)
+    p->println(F("Item ................ 1.00"));
+  p->boldOn();
+  p->println(F("TOTAL ............... 10.00"));
+  p->boldOff();
+  p->printBarcode("ADAFRUT", CODE39);
+  p->feed(3);
+}
+
+static unsigned long mismatches;
+
+// Estimates a job, then prints it and compares.
+static void check(const char *name, thermalJobFunc job) {
+  unsigned long bytes, est, actual;
+
+  est = printer.estimate(job, NULL, &bytes);
+  vp.startJob();
+  job(&printer, NULL);
+  if ((long)(vp.finishTime() - micros()) > 0)
+    delayMicroseconds(vp.finishTime() - micros());
+  actual = vp.jobTime();
+
+  double err = 100.0 * ((double)est - actual) / actual;
+  printf("%-20s %10.3f %10.3f %+8.1f%%  %-5s %8lu", name, est / 1e6,
+         actual / 1e6, err,
+         (err > TOLERANCE) ? "over" : (err < -TOLERANCE) ? "under" : "ok",
+         bytes);
+  if (bytes != vp.bytes) {
+    printf(" (sent %lu)", vp.bytes);
+    mismatches++;
+  }
+  printf("\n");
+}
+
+int main() {
+  for (size_t i = 0; i < sizeof(photo); i++)
+    photo[i] = (i * 37) ^ (i >> 5);
+
+  hostVirtualClock(10);
+  printer.begin();
+
+  printf("%-20s %10s %10s %9s  %-5s %8s\n", "job", "estimate", "measured",
+         "error", "", "bytes");
+  check("text lines", textLines);
+  check("wrapped text", wrappedText);
+  check("large text", largeText);
+  check("feed() lines", feedLines);
+  check("feedRows()", feedDots);
+  check("bitmap 75x75", logo);
+  check("bitmap 384x400", fullWidth);
+  check("barcodes", barcodes);
+  check("testPage()", testPage);
+  check("mixed receipt", receipt);
+
+  return mismatches ? 1 : 0;
+}
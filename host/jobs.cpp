@@ -0,0 +1,296 @@
+/*!
+ * @file jobs.cpp
+ *
+ * End-to-end job benchmark, run on the host.  A corpus of realistic jobs
+ * is printed through the library into VirtualPrinter, a timing model of
+ * the printer, with everything on the virtual clock, so each job's
+ * figures are in simulated wall time: how long the printer takes to
+ * finish it, how busy the serial link was, how long the head sat waiting
+ * for data between operations, and any buffer overruns (bytes the
+ * library sent faster than the printer could take them).  The bitmap jobs
+ * are run again as for firmware older than 2.68, which gets DC2 * chunks
+ * rather than a single GS v 0 raster command, and at half size scaled up
+ * by the printer (GS v 0) or by the library (DC2 *), along with a narrow
+ * strip whose DC2 * headers take up much of the buffer.  Then the text and
+ * image jobs again with setAutoHeat(), which should speed up sparse
+ * content without fading any rows (printing a row with more dots heated
+ * at once than the supply can take).  Last, some jobs are run through
+ * printJob() on a roll that runs out halfway, loading a new one and
+ * calling printJob() again each time it stops, as a sketch would; the
+ * report counts the printer operations lost to the empty roll, and how
+ * many more than the job needs ended up on paper (the stretch printed
+ * again on resuming).  Finally a mix of orders (receipt text, a picture
+ * and a barcode each) goes through Adafruit_ThermalPool to one, two and
+ * four printers, each a VirtualPrinter of its own, for the aggregate
+ * throughput.  Exits nonzero if any job overruns or fades, or ends up
+ * with less on paper than it needs.
+ *
+ * Build and run (from the library directory):
+ *   g++ -O2 -Ihost -I. Adafruit_Thermal.cpp Adafruit_ThermalRing.cpp \
+ *       Adafruit_ThermalTrace.cpp Adafruit_ThermalLayout.cpp \
+ *       Adafruit_ThermalPool.cpp Adafruit_ThermalNV.cpp host/Arduino.cpp \
+ *       host/VirtualPrinter.cpp host/jobs.cpp -o jobs
+ *   ./jobs
+ */
+
+#include "Adafruit_Thermal.h"
+#include "Adafruit_ThermalLayout.h"
+#include "Adafruit_ThermalPool.h"
+#include "VirtualPrinter.h"
+#include "examples/A_printertest/adalogo.h"
+
+#include <stdio.h>
+
+#define PHOTO_W 384   //!< Full printer width
+#define PHOTO_H 800   //!< Roughly a 10 cm photo
+#define BANNER_H 2400 //!< 30 cm banner, generated a row at a time
+#define ORDERS 8      //!< Orders spread over the pool
+#define PICTURE_H 200 //!< Rows of the photo printed with each order
+
+static VirtualPrinter vp;
+static Adafruit_Thermal printer(&vp), legacy(&vp), // legacy: DC2 * only
+    heat(&vp);                                        // heat: auto heat
+static uint8_t photo[PHOTO_W / 8 * PHOTO_H];
+
+static void receipt(Adafruit_Thermal *p) {
+  Adafruit_ThermalLayout layout(p);
+  static const char *const items[] = {"Coffee", "Croissant", "Bagel, toasted",
+                                      "Orange juice"};
+
+  p->justify('C');
+  p->setSize('M');
+  p->println(F("ADAFRUIT CAFE"));
+  p->setSize('S');
+  p->println(F("150 Varick St, New York"));
+  p->justify('L');
+  p->feed(1);
+  for (uint8_t i = 0; i < 24; i++) {
+    char price[8];
+    snprintf(price, sizeof(price), "%u.%02u", 1 + i % 7, (i * 35) % 100);
+    layout.print(items[i % 4]);
+    layout.leader(price);
+  }
+  layout.leader("TOTAL 97.40", ' ');
+  layout.println(F("Thank you for visiting. Receipts are printed on thermal "
+                   "paper; keep this one out of the sun if you need it."));
+  layout.flush();
+  p->feed(3);
+}
+
+static void logoBarcode(Adafruit_Thermal *p) {
+  p->printBitmap(adalogo_width, adalogo_height, adalogo_data);
+  p->feed(1);
+  p->setBarcodeHeight(80);
+  p->printBarcode("ADAFRUT", CODE39);
+  p->feed(3);
+}
+
+static void photograph(Adafruit_Thermal *p) {
+  p->printBitmap(PHOTO_W, PHOTO_H, photo, false);
+  p->feed(3);
+}
+
+// Banner: large blocky letters running down the paper, a row at a time.
+static const uint8_t *bannerRow(void * /*ctx*/, int y, uint8_t *buf) {
+  int band = (y / 40) % 8;
+  for (uint8_t x = 0; x < PHOTO_W / 8; x++)
+    buf[x] = ((band < 6) && ((x + band) % 6 < 4)) ? 0xFF : 0x00;
+  return buf;
+}
+
+static void banner(Adafruit_Thermal *p) {
+  p->printBitmap(PHOTO_W, BANNER_H, bannerRow, NULL);
+  p->feed(3);
+}
+
+// A narrow strip, where the chunk headers are a good part of what's sent.
+static void strip(Adafruit_Thermal *p) {
+  p->printBitmap(16, 1000, bannerRow, NULL);
+  p->feed(3);
+}
+
+// The same banner at half the resolution, scaled back up to full size.
+static void bannerScaled(Adafruit_Thermal *p) {
+  p->setBitmapScale(BITMAP_QUADRUPLE);
+  p->printBitmap(PHOTO_W / 2, BANNER_H / 2, bannerRow, NULL);
+  p->setBitmapScale(BITMAP_NORMAL);
+  p->feed(3);
+}
+
+// Synthetic photo: smooth shading with some detail, Floyd-Steinberg
+// dithered to one bit, as an image converter would.
+static void makePhoto() {
+  static int16_t err[2][PHOTO_W + 2];
+
+  memset(err, 0, sizeof(err));
+  for (int y = 0; y < PHOTO_H; y++) {
+    int16_t *cur = err[y & 1] + 1, *next = err[~y & 1] + 1;
+    memset(next - 1, 0, sizeof(err[0]));
+    for (int x = 0; x < PHOTO_W; x++) {
+      long dx = x - PHOTO_W / 2, dy = y - PHOTO_H / 3;
+      int v = 255 - (int)((dx * dx + dy * dy) / 400) + ((x ^ y) & 15);
+      v = ((v < 0) ? 0 : v) + cur[x];
+      int out = (v < 128) ? 0 : 255, e = v - out;
+      if (!out)
+        photo[y * (PHOTO_W / 8) + x / 8] |= 0x80 >> (x & 7);
+      cur[x + 1] += e * 7 / 16;
+      next[x - 1] += e * 3 / 16;
+      next[x] += e * 5 / 16;
+      next[x + 1] += e / 16;
+    }
+  }
+}
+
+static unsigned long totalOverruns, totalFaded, totalShort;
+
+// Runs one job and reports it once the printer has finished.
+static void run(const char *name, void (*job)(Adafruit_Thermal *p),
+                Adafruit_Thermal *p = &printer) {
+  unsigned long t;
+
+  vp.startJob();
+  job(p);
+  if ((long)(vp.finishTime() - micros()) > 0)
+    delayMicroseconds(vp.finishTime() - micros());
+  t = vp.jobTime();
+  printf("%-24s %10.3f %8lu %7.1f%% %9.3fs %8lu %6lu\n", name, t / 1e6,
+         vp.bytes, 100.0 * vp.linkBusy / t, vp.headIdle / 1e6, vp.overruns,
+         vp.faded);
+  totalOverruns += vp.overruns;
+  totalFaded += vp.faded;
+}
+
+// printJob() wrapper for the jobs above.
+struct paperJob {
+  void (*job)(Adafruit_Thermal *p);
+};
+
+static void runPaperJob(Adafruit_Thermal *p, void *ctx) {
+  ((paperJob *)ctx)->job(p);
+}
+
+// Runs one job with unlimited paper, to see how much it takes, then with
+// half that on the roll.
+static void runOut(const char *name, void (*job)(Adafruit_Thermal *p),
+                   Adafruit_Thermal *p = &printer) {
+  paperJob ctx = {job};
+  unsigned long needed, stops = 0, t;
+  long extra;
+
+  vp.startJob();
+  job(p);
+  needed = vp.operations;
+  vp.loadPaper(vp.paperUsed / 2);
+  vp.startJob();
+  while (!p->printJob(runPaperJob, &ctx)) {
+    vp.loadPaper(0);
+    stops++;
+  }
+  if ((long)(vp.finishTime() - micros()) > 0)
+    delayMicroseconds(vp.finishTime() - micros());
+  t = vp.jobTime();
+  extra = (long)(vp.operations - vp.lost) - (long)needed;
+  printf("%-24s %10.3f %8lu %6lu %6lu %9ld %8lu\n", name, t / 1e6, vp.bytes,
+         stops, vp.lost, extra, vp.overruns);
+  totalOverruns += vp.overruns;
+  if ((extra < 0) || !stops)
+    totalShort++;
+}
+
+// Receipt text for the pool, which takes jobs as strings.
+static char orderText[1024];
+
+static void makeOrderText() {
+  size_t n = snprintf(orderText, sizeof(orderText), "ADAFRUIT CAFE\n\n");
+  for (uint8_t i = 0; i < 20; i++)
+    n += snprintf(orderText + n, sizeof(orderText) - n,
+                  "Item %-16u %2u.%02u\n", i + 1, 1 + i % 7, (i * 35) % 100);
+  snprintf(orderText + n, sizeof(orderText) - n, "TOTAL 97.40\n\n");
+}
+
+// Spreads ORDERS orders over n printers and reports once all finish.
+static void runPool(uint8_t n) {
+  static VirtualPrinter vps[POOL_MAX_PRINTERS];
+  static Adafruit_Thermal printers[POOL_MAX_PRINTERS] = {
+      Adafruit_Thermal(&vps[0]), Adafruit_Thermal(&vps[1]),
+      Adafruit_Thermal(&vps[2]), Adafruit_Thermal(&vps[3])};
+  static unsigned long single;
+  Adafruit_ThermalPool pool;
+  unsigned long start, end, overruns = 0, t;
+  uint8_t i;
+
+  for (i = 0; i < n; i++) {
+    printers[i].begin();
+    vps[i].startJob();
+    pool.addPrinter(&printers[i]);
+  }
+  start = micros();
+  for (i = 0; i < ORDERS * 3;) { // Queues hold POOL_MAX_JOBS each
+    int8_t r = (i % 3 == 0)   ? pool.submit(orderText)
+               : (i % 3 == 1) ? pool.submitBitmap(PHOTO_W, PICTURE_H, photo,
+                                                  false)
+                              : pool.submitBarcode("ADAFRUT", CODE39);
+    if (r >= 0)
+      i++;
+    else if (pool.poll())
+      yield();
+  }
+  pool.run();
+  end = start;
+  for (i = 0; i < n; i++) {
+    if ((long)(vps[i].finishTime() - end) > 0)
+      end = vps[i].finishTime();
+    overruns += vps[i].overruns;
+  }
+  if ((long)(end - micros()) > 0)
+    delayMicroseconds(end - micros());
+  t = end - start;
+  if (n == 1)
+    single = t;
+  printf("%-24u %10.3f %10.1f %8.2f %8lu\n", n, t / 1e6,
+         ORDERS * 60e6 / t, (double)single / t, overruns);
+  totalOverruns += overruns;
+}
+
+int main() {
+  makePhoto();
+  hostVirtualClock(10);
+  printer.begin();
+  legacy.begin(264);
+  heat.begin();
+  heat.setAutoHeat();
+
+  printf("%-24s %10s %8s %8s %10s %8s %6s\n", "job", "time, s", "bytes",
+         "link %", "head idle", "overrun", "faded");
+  run("text receipt", receipt);
+  run("logo + barcode", logoBarcode);
+  run("dithered photo 384x800", photograph);
+  run("banner 384x2400", banner);
+  run("banner 192x1200 x4", bannerScaled);
+  run("photo, DC2 *", photograph, &legacy);
+  run("banner, DC2 *", banner, &legacy);
+  run("banner x4, DC2 *", bannerScaled, &legacy);
+  run("strip 16x1000, DC2 *", strip, &legacy);
+  run("text receipt, auto heat", receipt, &heat);
+  run("logo + barcode, auto", logoBarcode, &heat);
+  run("photo, auto heat", photograph, &heat);
+  run("banner, auto heat", banner, &heat);
+
+  printf("\n%-24s %10s %8s %6s %6s %9s %8s\n", "paper out halfway", "time, s",
+         "bytes", "stops", "lost", "reprinted", "overrun");
+  runOut("text receipt", receipt);
+  runOut("logo + barcode", logoBarcode);
+  runOut("dithered photo 384x800", photograph);
+  runOut("banner, DC2 *", banner, &legacy);
+  runOut("strip 16x1000, DC2 *", strip, &legacy);
+  runOut("text receipt, auto heat", receipt, &heat);
+
+  makeOrderText();
+  printf("\n%-24s %10s %10s %8s %8s\n", "printers in pool", "time, s",
+         "orders/min", "speedup", "overrun");
+  runPool(1);
+  runPool(2);
+  runPool(4);
+
+  return (totalOverruns || totalFaded || totalShort) ? 1 : 0;
+}
@@ -0,0 +1,322 @@
+/*!
+ * @file ringtest.cpp
+ *
+ * Contention test for Adafruit_ThermalRing, run on the host.  A producer
+ * thread writes a long pseudo-random mix of single bytes, blocks (some
+ * larger than a run), delay, row, sync and settle records, and flushes
+ * into a small ring while a consumer thread drains it.  Both threads
+ * generate the same sequence from the same seed, so the consumer checks
+ * every record as it arrives: data bytes in order with nothing lost or
+ * repeated, runs of 1 to RING_MAX_RUN bytes, annotations with their
+ * arguments intact and in their place in the data, and each bitmap row
+ * (the block after a row record) in a run of its own.  The ring indices
+ * wrap many times over.  Sizes the constructor must refuse are checked
+ * first.  Exits non-zero on any mismatch.
+ *
+ * Build and run (from the library directory):
+ *   g++ -O2 -Ihost -I. Adafruit_ThermalRing.cpp host/Arduino.cpp \
+ *       host/ringtest.cpp -o ringtest -lpthread
+ *   ./ringtest [operations, default 200000]
+ */
+
+#include "Adafruit_ThermalRing.h"
+
+#include <atomic>
+#include <thread>
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RING_SIZE RING_MIN_SIZE // Smallest ring, for the most contention
+
+// Operations, in the order both threads generate them:
+enum {
+  OP_BYTES,
+  OP_BLOCK,
+  OP_DELAY,
+  OP_ROW,
+  OP_ROW_DATA,
+  OP_SYNC,
+  OP_SETTLE,
+  OP_FLUSH
+};
+
+struct Op {
+  uint8_t kind;
+  uint16_t n;          // Data bytes (OP_BYTES, OP_BLOCK, OP_ROW_DATA)
+  uint16_t rows;       // Buffered rows (OP_ROW)
+  unsigned long value; // Delay (OP_DELAY, OP_SETTLE) or row time (OP_ROW)
+};
+
+// Operation sequence, identical on both threads for the same seed.
+class OpSource {
+public:
+  OpSource() : seed(12345), rowNext(false), rowLen(0) {}
+  void next(Op *op) {
+    if (rowNext) { // A row record is always followed by its row
+      rowNext = false;
+      op->kind = OP_ROW_DATA;
+      op->n = rowLen;
+      return;
+    }
+    switch (random(16)) {
+    case 0:
+    case 1:
+    case 2:
+    case 3:
+    case 4:
+      op->kind = OP_BYTES;
+      op->n = 1 + random(100);
+      break;
+    case 5:
+    case 6:
+    case 7:
+    case 8:
+      op->kind = OP_BLOCK;
+      op->n = 1 + random(150); // Up to a couple of runs
+      break;
+    case 9:
+    case 10:
+      op->kind = (random(4) == 0) ? OP_SETTLE : OP_DELAY;
+      op->value = random32();
+      break;
+    case 11:
+    case 12:
+    case 13:
+      op->kind = OP_ROW;
+      op->rows = random32();
+      op->value = random32();
+      rowLen = 1 + random(48);
+      rowNext = true;
+      break;
+    case 14:
+      op->kind = OP_SYNC;
+      break;
+    default:
+      op->kind = OP_FLUSH;
+      break;
+    }
+  }
+
+private:
+  uint32_t seed;
+  bool rowNext;
+  uint16_t rowLen;
+  uint32_t random32() { // xorshift32
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+  }
+  uint16_t random(uint16_t n) { return random32() % n; }
+};
+
+// The k'th data byte written, so reordering or loss shows up.
+static uint8_t dataByte(unsigned long k) {
+  return (uint8_t)((k * 2654435761UL) >> 13);
+}
+
+static uint8_t ringBuf[RING_SIZE];
+static Adafruit_ThermalRing ring(ringBuf, sizeof ringBuf);
+static unsigned long numOps = 200000;
+static std::atomic<bool> produced(false); // Set once all is written
+
+static void producer() {
+  OpSource src;
+  Op op;
+  uint8_t block[150];
+  unsigned long k = 0;
+
+  for (unsigned long i = 0; i < numOps; i++) {
+    src.next(&op);
+    switch (op.kind) {
+    case OP_BYTES:
+      for (uint16_t j = 0; j < op.n; j++)
+        ring.write(dataByte(k++));
+      break;
+    case OP_BLOCK:
+    case OP_ROW_DATA:
+      for (uint16_t j = 0; j < op.n; j++)
+        block[j] = dataByte(k++);
+      ring.write(block, op.n);
+      break;
+    case OP_DELAY:
+      ring.pushDelay(op.value);
+      break;
+    case OP_ROW:
+      ring.pushRow(op.rows, op.value);
+      break;
+    case OP_SYNC:
+      ring.pushSync();
+      break;
+    case OP_SETTLE:
+      ring.pushSettle(op.value);
+      break;
+    case OP_FLUSH:
+      ring.flush();
+      break;
+    }
+  }
+  ring.flush();
+  produced = true;
+}
+
+static unsigned long errors = 0, records[6];
+
+static void fail(unsigned long i, const char *what) {
+  if (++errors <= 10)
+    fprintf(stderr, "operation %lu: %s\n", i, what);
+}
+
+static void consumer() {
+  OpSource src;
+  Op op;
+  uint8_t run[256]; // Room for any header value, should one be corrupt
+  unsigned long i = 0, k = 0;
+  uint16_t left = 0; // Data bytes of operation i not yet received
+  bool more = true;  // False once every operation has been fetched
+  bool check = true; // False after too many errors: just drain the ring
+
+  // Fetch the next operation that puts something in the ring.
+  auto advance = [&]() {
+    while ((more = (i < numOps))) {
+      src.next(&op);
+      i++;
+      if (op.kind == OP_FLUSH)
+        continue;
+      left = ((op.kind == OP_BYTES) || (op.kind == OP_BLOCK) ||
+              (op.kind == OP_ROW_DATA))
+                 ? op.n
+                 : 0;
+      if (left || (op.kind >= OP_DELAY))
+        return;
+    }
+  };
+  // An annotation must follow all the data before it.
+  auto expect = [&](uint8_t kind) {
+    if (left)
+      fail(i, "annotation before end of data");
+    advance();
+    if (!more || (op.kind != kind)) {
+      fail(i, "wrong record type");
+      return false;
+    }
+    return true;
+  };
+
+  for (;;) {
+    uint8_t type = ring.peekType(), n;
+    uint16_t rows;
+    unsigned long value;
+
+    if (type == RING_EMPTY) {
+      if (produced && (ring.peekType() == RING_EMPTY))
+        break;
+      sched_yield();
+      continue;
+    }
+    records[type]++;
+    if (!check) { // (Still drained, so the producer doesn't block)
+      ring.skip();
+      continue;
+    }
+    switch (type) {
+    case RING_RUN:
+      n = ring.readRun(run);
+      if (!n || (n > RING_MAX_RUN))
+        fail(i, "bad run length");
+      if ((op.kind == OP_ROW_DATA) && (left == op.n) && (n != op.n))
+        fail(i, "row split or merged");
+      for (uint8_t j = 0; j < n; j++) {
+        if (!left)
+          advance();
+        if (!left) {
+          fail(i, "data in place of an annotation");
+          check = false;
+          break;
+        }
+        if (run[j] != dataByte(k++))
+          fail(i, "data byte mismatch");
+        left--;
+      }
+      break;
+    case RING_DELAY:
+      value = ring.readValue();
+      if (expect(OP_DELAY) && (value != op.value))
+        fail(i, "delay value mismatch");
+      break;
+    case RING_ROW:
+      ring.readRow(&rows, &value);
+      if (expect(OP_ROW) && ((rows != op.rows) || (value != op.value)))
+        fail(i, "row arguments mismatch");
+      advance(); // To the row itself, which the next run must be
+      break;
+    case RING_SYNC:
+      ring.skip();
+      expect(OP_SYNC);
+      break;
+    case RING_SETTLE:
+      value = ring.readValue();
+      if (expect(OP_SETTLE) && (value != op.value))
+        fail(i, "settle value mismatch");
+      break;
+    }
+    if (errors > 10)
+      check = false;
+  }
+  if (!check)
+    return;
+  if (!left)
+    advance();
+  if (left || more)
+    fail(i, "data missing at end");
+}
+
+// Sizes the constructor must refuse: too small for a full run and its
+// header, not a power of two, or no buffer.  None may block a writer.
+static void checkSizes() {
+  static uint8_t buf[RING_MAX_RUN * 2];
+  const uint16_t bad[] = {0, 1, 64, 65, 100, 127, 129, 192};
+
+  for (uint8_t i = 0; i < sizeof bad / sizeof bad[0]; i++) {
+    Adafruit_ThermalRing r(buf, bad[i]);
+    uint8_t c = 0;
+    if (r.valid() || r.write(c) || r.write(&c, 1)) {
+      fprintf(stderr, "size %u accepted\n", bad[i]);
+      errors++;
+    }
+    r.pushDelay(1);
+    r.pushRow(1, 1);
+    r.pushSync();
+    r.pushSettle(1);
+    if (r.peekType() != RING_EMPTY) {
+      fprintf(stderr, "size %u ring not empty\n", bad[i]);
+      errors++;
+    }
+  }
+  Adafruit_ThermalRing none(NULL, RING_MIN_SIZE);
+  Adafruit_ThermalRing good(buf, sizeof buf);
+  if (none.valid() || !good.valid()) {
+    fprintf(stderr, "NULL buffer accepted or valid size refused\n");
+    errors++;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1)
+    numOps = strtoul(argv[1], NULL, 0);
+
+  checkSizes();
+
+  std::thread consumerThread(consumer);
+  std::thread producerThread(producer);
+  producerThread.join();
+  consumerThread.join();
+
+  printf("Ring of %d bytes, %lu operations: %lu runs, %lu delays, %lu rows, "
+         "%lu syncs, %lu settles; %lu errors\n",
+         RING_SIZE, numOps, records[RING_RUN], records[RING_DELAY],
+         records[RING_ROW], records[RING_SYNC], records[RING_SETTLE], errors);
+  return errors ? 1 : 0;
+}
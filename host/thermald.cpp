@@ -0,0 +1,164 @@
+/*!
+ * @file thermald.cpp
+ *
+ * Small print spooler for Linux hosts driving a serial thermal printer.
+ * Clients connect to a Unix domain socket, send the job text and close
+ * (or shut down their write side); the job is queued and the connection
+ * is released immediately, so clients never wait on physical print
+ * time.  A dedicated writer thread drives Adafruit_Thermal, which paces
+ * output to the printer as it would on a microcontroller.
+ *
+ * Build (from the library directory):
+ *   g++ -O2 -Ihost -I. Adafruit_Thermal.cpp Adafruit_ThermalRing.cpp \
+ *       Adafruit_ThermalTrace.cpp host/Arduino.cpp host/PosixSerial.cpp \
+ *       host/thermald.cpp -o thermald -lpthread
+ *
+ * Usage:
+ *   thermald [-b baud] [-f firmware] device socket
+ *   echo "Hello World!" | nc -U -N socket
+ *
+ * To try it without a printer, create a pty loopback and watch the
+ * bytes the printer would receive:
+ *   socat -d -d pty,raw,echo=0 pty,raw,echo=0   (prints two pty paths)
+ *   thermald /dev/pts/N /tmp/thermal.sock
+ *   hexdump -C < /dev/pts/M
+ */
+
+#include "Adafruit_Thermal.h"
+#include "PosixSerial.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static std::deque<std::string> jobs;
+static std::mutex jobLock;
+static std::condition_variable jobReady;
+static volatile sig_atomic_t quit = 0;
+static bool stopping = false; // Guarded by jobLock
+
+static void onSignal(int) { quit = 1; }
+
+// Writer thread: the only code that touches the printer.  Jobs already
+// queued when the daemon is stopped are still printed.
+static void writer(Adafruit_Thermal *printer) {
+  for (;;) {
+    std::string job;
+    {
+      std::unique_lock<std::mutex> lock(jobLock);
+      jobReady.wait(lock, [] { return stopping || !jobs.empty(); });
+      if (jobs.empty())
+        return;
+      job.swap(jobs.front());
+      jobs.pop_front();
+    }
+    static_cast<Print *>(printer)->write((const uint8_t *)job.data(),
+                                         job.size());
+    printer->feed(2);
+  }
+}
+
+// Read one job from a client connection until EOF.
+static bool readJob(int client, std::string &job) {
+  char buf[4096];
+  for (;;) {
+    ssize_t n = read(client, buf, sizeof(buf));
+    if (n > 0)
+      job.append(buf, n);
+    else if (n == 0)
+      return true;
+    else if (errno != EINTR)
+      return false;
+  }
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "usage: %s [-b baud] [-f firmware] device socket\n", name);
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long baud = 19200;
+  int firmware = 268, opt;
+
+  while ((opt = getopt(argc, argv, "b:f:")) != -1) {
+    switch (opt) {
+    case 'b':
+      baud = strtoul(optarg, NULL, 10);
+      break;
+    case 'f':
+      firmware = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (argc - optind != 2)
+    usage(argv[0]);
+  const char *device = argv[optind], *socketPath = argv[optind + 1];
+
+  static PosixSerial port;
+  if (!port.begin(device, baud)) {
+    perror(device);
+    return 1;
+  }
+
+  struct sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "%s: socket path too long\n", socketPath);
+    return 1;
+  }
+  strcpy(addr.sun_path, socketPath);
+  int server = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(socketPath);
+  if ((server < 0) || (bind(server, (struct sockaddr *)&addr, sizeof(addr))) ||
+      listen(server, 8)) {
+    perror(socketPath);
+    return 1;
+  }
+
+  struct sigaction sa = {};
+  sa.sa_handler = onSignal; // No SA_RESTART: accept() returns on signal
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  static Adafruit_Thermal printer(&port);
+  printer.setBaudRate(baud);
+  printer.begin(firmware);
+  std::thread writerThread(writer, &printer);
+
+  while (!quit) {
+    int client = accept(server, NULL, NULL);
+    if (client < 0)
+      continue;
+    std::string job;
+    if (readJob(client, job) && !job.empty()) {
+      std::lock_guard<std::mutex> lock(jobLock);
+      jobs.push_back(std::move(job));
+      jobReady.notify_one();
+    }
+    close(client);
+  }
+
+  close(server);
+  unlink(socketPath);
+  {
+    std::lock_guard<std::mutex> lock(jobLock);
+    stopping = true;
+    jobReady.notify_one();
+  }
+  writerThread.join();
+  return 0;
+}
@@ -0,0 +1,95 @@
+#!/usr/bin/env python
+#
+# This Python script converts a dump from Adafruit_ThermalTrace::dump()
+# (e.g. captured from the serial monitor to a file) into Chrome trace
+# event JSON, for viewing as a timeline in chrome://tracing or
+# https://ui.perfetto.dev.  Waits and data writes appear as spans, commands,
+# bitmap chunks and sketch marks as instants, and DTR as a counter.
+#
+
+import sys
+import json
+import struct
+import argparse
+
+TRACE_COMMAND, TRACE_WRITE, TRACE_WAIT, TRACE_CHUNK, TRACE_DTR, TRACE_MARK = \
+    range(1, 7)
+PREFIXES = {27: 'ESC', 29: 'GS', 18: 'DC2', 28: 'FS'}
+THREADS = {1: 'waits', 2: 'output', 3: 'bitmap', 4: 'sketch'}
+
+# command line parsing
+parser = argparse.ArgumentParser(
+    description='Convert a thermal printer trace dump to Chrome trace JSON.')
+parser.add_argument('dump', help='binary dump file, or - for stdin')
+parser.add_argument('-o', '--out_name', help='output file (default stdout)')
+parser.add_argument('-b', '--baud', type=int, default=19200,
+                    help='baud rate, for the duration of writes')
+args = parser.parse_args()
+
+
+def command_name(value, size):
+    """Readable form of a command, e.g. 'ESC 3 30'."""
+    data = [(value >> (8 * i)) & 0xFF for i in range(size)]
+    words = []
+    for i, b in enumerate(data):
+        if i == 0 and b in PREFIXES:
+            words.append(PREFIXES[b])
+        elif i == 1 and data[0] in PREFIXES and 32 < b < 127:
+            words.append(chr(b))
+        else:
+            words.append(str(b))
+    return ' '.join(words)
+
+
+# read the dump, skipping anything captured ahead of it
+raw = sys.stdin.buffer.read() if args.dump == '-' else \
+    open(args.dump, 'rb').read()
+start = raw.find(b'THTR')
+if start < 0 or len(raw) < start + 14:
+    sys.exit('No trace dump found in ' + args.dump)
+version, count, dropped, waited = struct.unpack_from('<BBII', raw, start + 4)
+if version != 1:
+    sys.exit('Unsupported dump version %d' % version)
+events = [struct.unpack_from('<IIBB', raw, start + 14 + 10 * i)
+          for i in range(count)]
+
+# micros() wraps every 71 minutes; unwrap so the timeline runs forward
+byte_time = 11e6 / args.baud
+out = [{'ph': 'M', 'name': 'thread_name', 'pid': 1, 'tid': tid,
+        'args': {'name': name}} for tid, name in THREADS.items()]
+offset = 0
+last = events[0][0] if events else 0
+for time, value, kind, size in events:
+    if time < last and last - time > 0x80000000:
+        offset += 0x100000000
+    last = time
+    ts = time + offset
+    if kind == TRACE_WAIT:
+        out.append({'ph': 'X', 'name': 'wait', 'pid': 1, 'tid': 1,
+                    'ts': ts, 'dur': value})
+    elif kind == TRACE_WRITE:
+        out.append({'ph': 'X', 'name': '%d bytes' % value, 'pid': 1,
+                    'tid': 2, 'ts': ts, 'dur': value * byte_time,
+                    'args': {'bytes': value}})
+    elif kind == TRACE_COMMAND:
+        out.append({'ph': 'i', 's': 't', 'name': command_name(value, size),
+                    'pid': 1, 'tid': 2, 'ts': ts})
+    elif kind == TRACE_CHUNK:
+        out.append({'ph': 'i', 's': 't', 'pid': 1, 'tid': 3, 'ts': ts,
+                    'name': 'chunk %d rows x %d bytes' % (value, size)})
+    elif kind == TRACE_DTR:
+        out.append({'ph': 'C', 'name': 'DTR ready', 'pid': 1, 'ts': ts,
+                    'args': {'ready': value}})
+    elif kind == TRACE_MARK:
+        out.append({'ph': 'i', 's': 't', 'name': 'mark %d' % value,
+                    'pid': 1, 'tid': 4, 'ts': ts})
+
+# write the trace
+text = json.dumps({'traceEvents': out, 'displayTimeUnit': 'ms'}, indent=1)
+if args.out_name:
+    with open(args.out_name, 'w') as f:
+        f.write(text)
+else:
+    print(text)
+sys.stderr.write('%d events, %d dropped, %.3f s waiting in total\n' %
+                 (count, dropped, waited / 1e6))